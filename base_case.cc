@@ -0,0 +1,310 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "base_case.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+// This file is compiled for the baseline instruction set of the build. Each kernel
+// enables its own instruction set with a target attribute and is marked flatten so
+// that the shared kernel body and Op accessors are inlined into it. Nothing compiled
+// for a wider instruction set is reachable unless detect_simd_level() allows it.
+
+namespace {
+// Widest vector is 64 bytes, pad local distances so the last vector stays in bounds
+constexpr size_t kMaxLanes = 32;
+
+// Each Simd struct provides range_incr(dist, lo, hi) which adds 1 to dist[lo..hi].
+// Lanes are selected by comparing their index against lo and hi so no scalar
+// head or tail loop is necessary. Indices are < kMaxBruteBaseCase + kMaxLanes < 2^15
+// so signed compares are safe.
+template <typename Lane>
+struct Scalar {
+  static inline void range_incr(Lane* dist, size_t lo, size_t hi) {
+    for (size_t j = lo; j <= hi; j++) dist[j]++;
+  }
+};
+
+template <typename Lane> struct Sse42;
+template <> struct Sse42<uint16_t> {
+  static constexpr size_t kLanes = 8;
+  __attribute__((target("sse4.2")))
+  static inline void range_incr(uint16_t* dist, size_t lo, size_t hi) {
+    const __m128i iota = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m128i below = _mm_set1_epi16(lo - 1);
+    const __m128i above = _mm_set1_epi16(hi + 1);
+    for (size_t v = lo / kLanes * kLanes; v <= hi; v += kLanes) {
+      __m128i idx = _mm_add_epi16(iota, _mm_set1_epi16(v));
+      __m128i mask = _mm_and_si128(_mm_cmpgt_epi16(idx, below), _mm_cmplt_epi16(idx, above));
+      __m128i* ptr = (__m128i*)(dist + v);
+      _mm_storeu_si128(ptr, _mm_sub_epi16(_mm_loadu_si128(ptr), mask));
+    }
+  }
+};
+template <> struct Sse42<uint32_t> {
+  static constexpr size_t kLanes = 4;
+  __attribute__((target("sse4.2")))
+  static inline void range_incr(uint32_t* dist, size_t lo, size_t hi) {
+    const __m128i iota = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i below = _mm_set1_epi32(lo - 1);
+    const __m128i above = _mm_set1_epi32(hi + 1);
+    for (size_t v = lo / kLanes * kLanes; v <= hi; v += kLanes) {
+      __m128i idx = _mm_add_epi32(iota, _mm_set1_epi32(v));
+      __m128i mask = _mm_and_si128(_mm_cmpgt_epi32(idx, below), _mm_cmplt_epi32(idx, above));
+      __m128i* ptr = (__m128i*)(dist + v);
+      _mm_storeu_si128(ptr, _mm_sub_epi32(_mm_loadu_si128(ptr), mask));
+    }
+  }
+};
+
+template <typename Lane> struct Avx2;
+template <> struct Avx2<uint16_t> {
+  static constexpr size_t kLanes = 16;
+  __attribute__((target("avx2")))
+  static inline void range_incr(uint16_t* dist, size_t lo, size_t hi) {
+    const __m256i iota = _mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m256i below = _mm256_set1_epi16(lo - 1);
+    const __m256i above = _mm256_set1_epi16(hi + 1);
+    for (size_t v = lo / kLanes * kLanes; v <= hi; v += kLanes) {
+      __m256i idx = _mm256_add_epi16(iota, _mm256_set1_epi16(v));
+      __m256i mask = _mm256_and_si256(_mm256_cmpgt_epi16(idx, below),
+                                      _mm256_cmpgt_epi16(above, idx));
+      __m256i* ptr = (__m256i*)(dist + v);
+      _mm256_storeu_si256(ptr, _mm256_sub_epi16(_mm256_loadu_si256(ptr), mask));
+    }
+  }
+};
+template <> struct Avx2<uint32_t> {
+  static constexpr size_t kLanes = 8;
+  __attribute__((target("avx2")))
+  static inline void range_incr(uint32_t* dist, size_t lo, size_t hi) {
+    const __m256i iota = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i below = _mm256_set1_epi32(lo - 1);
+    const __m256i above = _mm256_set1_epi32(hi + 1);
+    for (size_t v = lo / kLanes * kLanes; v <= hi; v += kLanes) {
+      __m256i idx = _mm256_add_epi32(iota, _mm256_set1_epi32(v));
+      __m256i mask = _mm256_and_si256(_mm256_cmpgt_epi32(idx, below),
+                                      _mm256_cmpgt_epi32(above, idx));
+      __m256i* ptr = (__m256i*)(dist + v);
+      _mm256_storeu_si256(ptr, _mm256_sub_epi32(_mm256_loadu_si256(ptr), mask));
+    }
+  }
+};
+
+template <typename Lane> struct Avx512;
+template <> struct Avx512<uint16_t> {
+  static constexpr size_t kLanes = 32;
+  __attribute__((target("avx512f,avx512bw")))
+  static inline void range_incr(uint16_t* dist, size_t lo, size_t hi) {
+    const __m512i iota = _mm512_set_epi16(31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19,
+                                          18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4,
+                                          3, 2, 1, 0);
+    const __m512i ones = _mm512_set1_epi16(1);
+    const __m512i first = _mm512_set1_epi16(lo);
+    const __m512i last = _mm512_set1_epi16(hi);
+    for (size_t v = lo / kLanes * kLanes; v <= hi; v += kLanes) {
+      __m512i idx = _mm512_add_epi16(iota, _mm512_set1_epi16(v));
+      __mmask32 mask = _mm512_cmpge_epu16_mask(idx, first) & _mm512_cmple_epu16_mask(idx, last);
+      __m512i* ptr = (__m512i*)(dist + v);
+      _mm512_storeu_si512(ptr, _mm512_mask_add_epi16(_mm512_loadu_si512(ptr), mask,
+                                                    _mm512_loadu_si512(ptr), ones));
+    }
+  }
+};
+template <> struct Avx512<uint32_t> {
+  static constexpr size_t kLanes = 16;
+  __attribute__((target("avx512f")))
+  static inline void range_incr(uint32_t* dist, size_t lo, size_t hi) {
+    const __m512i iota = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512i ones = _mm512_set1_epi32(1);
+    const __m512i first = _mm512_set1_epi32(lo);
+    const __m512i last = _mm512_set1_epi32(hi);
+    for (size_t v = lo / kLanes * kLanes; v <= hi; v += kLanes) {
+      __m512i idx = _mm512_add_epi32(iota, _mm512_set1_epi32(v));
+      __mmask16 mask = _mm512_cmpge_epu32_mask(idx, first) & _mm512_cmple_epu32_mask(idx, last);
+      __m512i* ptr = (__m512i*)(dist + v);
+      _mm512_storeu_si512(ptr, _mm512_mask_add_epi32(_mm512_loadu_si512(ptr), mask,
+                                                    _mm512_loadu_si512(ptr), ones));
+    }
+  }
+};
+
+// The brute force base case shared by every instruction set
+template <typename Lane, typename Simd, typename OpT>
+inline size_t solve_base_case(const OpT* ops, size_t num_ops, typename OpT::Time start, typename OpT::Time end,
+                              int64_t* depths) {
+  const typename OpT::Time last = end - start;
+  assert(last < kMaxBruteBaseCase);
+
+  // default sized leaves fit on the stack, bigger ones use a per thread buffer
+  alignas(64) Lane stack_distances[kIafBaseCase + kMaxLanes];
+  thread_local std::vector<Lane> heap_distances;
+  Lane* local_distances = stack_distances;
+  if (last >= kIafBaseCase) {
+    if (heap_distances.size() < last + 1 + kMaxLanes) heap_distances.resize(last + 1 + kMaxLanes);
+    local_distances = heap_distances.data();
+  }
+  std::memset(local_distances, 0, (last + 1 + kMaxLanes) * sizeof(Lane));
+
+  // Full amounts may wrap within the width of OpT but every stack depth fits in it
+  int64_t full_amnt = 0;
+  size_t num_depths = 0;
+  for (size_t i = 0; i < num_ops; i++) {
+    const OpT &op = ops[i];
+
+    switch(op.get_type()) {
+      case Prefix:
+        if (op.get_target() >= start)
+          Simd::range_incr(local_distances, 0, std::min(op.get_target() - start, last));
+        break;
+
+      case Postfix:
+        Simd::range_incr(local_distances, std::max(op.get_target(), start) - start, last);
+
+        // Freeze target by recording its stack depth
+        if (op.get_target() != 0)
+          depths[num_depths++] = (typename OpT::SignedWord)(local_distances[op.get_target() - start]
+                                                            + full_amnt);
+        break;
+
+      default: // Null
+        break;
+    }
+
+    // Add full amount
+    full_amnt += op.get_full_amnt();
+  }
+  return num_depths;
+}
+
+template <typename Lane, typename OpT>
+__attribute__((flatten))
+size_t scalar_kernel(const OpT* ops, size_t num_ops, typename OpT::Time start, typename OpT::Time end,
+                     int64_t* depths) {
+  return solve_base_case<Lane, Scalar<Lane>, OpT>(ops, num_ops, start, end, depths);
+}
+
+template <typename Lane, typename OpT>
+__attribute__((target("sse4.2"), flatten))
+size_t sse42_kernel(const OpT* ops, size_t num_ops, typename OpT::Time start, typename OpT::Time end,
+                    int64_t* depths) {
+  return solve_base_case<Lane, Sse42<Lane>, OpT>(ops, num_ops, start, end, depths);
+}
+
+template <typename Lane, typename OpT>
+__attribute__((target("avx2"), flatten))
+size_t avx2_kernel(const OpT* ops, size_t num_ops, typename OpT::Time start, typename OpT::Time end,
+                   int64_t* depths) {
+  return solve_base_case<Lane, Avx2<Lane>, OpT>(ops, num_ops, start, end, depths);
+}
+
+template <typename Lane, typename OpT>
+__attribute__((target("avx512f,avx512bw"), flatten))
+size_t avx512_kernel(const OpT* ops, size_t num_ops, typename OpT::Time start, typename OpT::Time end,
+                     int64_t* depths) {
+  return solve_base_case<Lane, Avx512<Lane>, OpT>(ops, num_ops, start, end, depths);
+}
+}  // namespace
+
+template <typename OpT>
+size_t fenwick_base_case(const OpT* ops, size_t num_ops, typename OpT::Time start, typename OpT::Time end,
+                         int64_t* depths) {
+  // The distance of request x is the number of Prefixes so far minus those ending before x
+  // plus the number of Postfixes starting at or before x. The tree holds a -1 just past the
+  // end of every Prefix and a +1 at the start of every Postfix. Unsigned arithmetic wraps
+  // but every prefix sum is non-negative.
+  const size_t len = end - start + 1;
+  thread_local std::vector<uint32_t> tree; // 1-indexed Fenwick tree
+  tree.assign(len + 1, 0);
+  auto update = [&](size_t idx, uint32_t delta) {
+    for (size_t i = idx + 1; i <= len; i += i & -i) tree[i] += delta;
+  };
+  auto query = [&](size_t idx) {
+    uint32_t sum = 0;
+    for (size_t i = idx + 1; i > 0; i -= i & -i) sum += tree[i];
+    return sum;
+  };
+
+  uint32_t num_prefixes = 0;
+  int64_t full_amnt = 0;
+  size_t num_depths = 0;
+  for (size_t i = 0; i < num_ops; i++) {
+    const OpT &op = ops[i];
+
+    switch(op.get_type()) {
+      case Prefix:
+        if (op.get_target() >= start) {
+          ++num_prefixes;
+          if (op.get_target() < end) update(op.get_target() - start + 1, -1);
+        }
+        break;
+
+      case Postfix:
+        if (op.get_target() <= end)
+          update(std::max(op.get_target(), start) - start, 1);
+
+        // Freeze target by recording its stack depth
+        if (op.get_target() != 0)
+          depths[num_depths++] = (typename OpT::SignedWord)(num_prefixes + query(op.get_target() - start)
+                                                            + full_amnt);
+        break;
+
+      default: // Null
+        break;
+    }
+
+    // Add full amount
+    full_amnt += op.get_full_amnt();
+  }
+  return num_depths;
+}
+
+SimdLevel detect_simd_level() {
+  static const SimdLevel level = []() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+      return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2"))   return SIMD_AVX2;
+    if (__builtin_cpu_supports("sse4.2")) return SIMD_SSE42;
+    return SIMD_SCALAR;
+  }();
+  return level;
+}
+
+template <typename OpT>
+BaseCaseKernel<OpT> base_case_kernel(SimdLevel level, bool narrow) {
+  switch (level) {
+    case SIMD_SCALAR: return narrow ? scalar_kernel<uint16_t, OpT> : scalar_kernel<uint32_t, OpT>;
+    case SIMD_SSE42:  return narrow ? sse42_kernel<uint16_t, OpT>  : sse42_kernel<uint32_t, OpT>;
+    case SIMD_AVX2:   return narrow ? avx2_kernel<uint16_t, OpT>   : avx2_kernel<uint32_t, OpT>;
+    case SIMD_AVX512: return narrow ? avx512_kernel<uint16_t, OpT> : avx512_kernel<uint32_t, OpT>;
+  }
+  return nullptr;
+}
+
+template BaseCaseKernel<WideOp> base_case_kernel<WideOp>(SimdLevel level, bool narrow);
+template size_t fenwick_base_case<WideOp>(const WideOp*, size_t, uint64_t, uint64_t, int64_t*);
+template BaseCaseKernel<CompactOp> base_case_kernel<CompactOp>(SimdLevel level, bool narrow);
+template size_t fenwick_base_case<CompactOp>(const CompactOp*, size_t, uint32_t, uint32_t,
+                                             int64_t*);
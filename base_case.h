@@ -0,0 +1,69 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef ONLINE_CACHE_SIMULATOR_BASE_CASE_H_
+#define ONLINE_CACHE_SIMULATOR_BASE_CASE_H_
+
+#include <cstddef>      // for size_t
+#include <cstdint>      // for int64_t
+
+#include "iaf_params.h" // for SimdLevel
+#include "op.h"         // for Op, CompactOp
+
+/*
+ * Kernel that solves a base case projected sequence without further recursion.
+ * Kernels are instantiated for both WideOp and CompactOp.
+ * ops:     the operations of the projected sequence
+ * start:   first request of the projected sequence
+ * end:     last request of the projected sequence
+ * depths:  the stack depth of every frozen Postfix is written here in order.
+ *          Must have space for num_ops depths.
+ * returns  the number of depths written
+ */
+template <typename OpT = Op>
+using BaseCaseKernel = size_t (*)(const OpT* ops, size_t num_ops, typename OpT::Time start,
+                                  typename OpT::Time end, int64_t* depths);
+
+// Highest SimdLevel supported by this CPU and OS. Queried from CPUID once.
+SimdLevel detect_simd_level();
+
+/*
+ * The brute force kernel that uses instruction set level. This takes time O(k*n) for
+ * k ops upon n requests. Requires end - start < kMaxBruteBaseCase.
+ * narrow: If true then distances are counted in 16 bit lanes. Only valid if num_ops < 2^16.
+ */
+template <typename OpT = Op>
+BaseCaseKernel<OpT> base_case_kernel(SimdLevel level, bool narrow);
+
+// Largest number of ops for which a narrow kernel may be used
+constexpr size_t kNarrowBaseCaseOps = UINT16_MAX;
+
+// Largest number of requests that a brute force kernel may solve
+constexpr size_t kMaxBruteBaseCase = 16384;
+
+/*
+ * Kernel that solves a projected sequence with a Fenwick tree over the difference array of
+ * the local distances. This takes time O(k log n) for k ops upon n requests and is not
+ * limited in n, so base cases of many thousands of requests remain cheap.
+ */
+template <typename OpT>
+size_t fenwick_base_case(const OpT* ops, size_t num_ops, typename OpT::Time start,
+                         typename OpT::Time end, int64_t* depths);
+
+#endif  // ONLINE_CACHE_SIMULATOR_BASE_CASE_H_
@@ -19,19 +19,24 @@
 
 #include "bounded_iaf.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <utility>
 #include <vector>
 
 #include "increment_and_freeze.h"
+#include "prefix_sum.h"
 
-void BoundedIAF::memory_access(req_count_t addr) {
+template <typename Addr, typename Time, typename Count>
+void BasicBoundedIAF<Addr, Time, Count>::memory_access(uint64_t addr) {
+  if (addr > std::numeric_limits<Addr>::max()) id_width_error(addr, get_max_id());
   ++access_number;
-  chunk_input.requests.push_back({addr, (req_count_t) chunk_input.requests.size() + 1});
+  chunk_input.requests.push_back({(Addr) addr, (Time) chunk_input.requests.size() + 1});
 
   if (chunk_input.requests.size() >= get_u()) {
     // std::cout << "requests chunk array:" << std::endl;
@@ -43,7 +48,41 @@ void BoundedIAF::memory_access(req_count_t addr) {
   }
 }
 
-void print_result(IncrementAndFreeze::ChunkOutput& result) {
+template <typename Addr, typename Time, typename Count>
+void BasicBoundedIAF<Addr, Time, Count>::extent_access(uint64_t first_addr, size_t num_blocks) {
+  access_number += num_blocks;
+  while (num_blocks > 0) {
+    size_t filled = chunk_input.requests.size();
+    size_t piece = std::min(get_u() > filled ? get_u() - filled : 1, num_blocks);
+    iaf_alg.append_extent(chunk_input.requests, first_addr, piece);
+    first_addr += piece;
+    num_blocks -= piece;
+    if (chunk_input.requests.size() >= get_u()) process_requests();
+  }
+}
+
+template <typename Addr, typename Time, typename Count>
+void BasicBoundedIAF<Addr, Time, Count>::key_access(uint64_t key) {
+  ++access_number;
+  iaf_alg.append_keys(chunk_input.requests, &key, 1);
+  if (chunk_input.requests.size() >= get_u()) process_requests();
+}
+
+template <typename Addr, typename Time, typename Count>
+void BasicBoundedIAF<Addr, Time, Count>::key_batch_access(const uint64_t* keys, size_t num) {
+  access_number += num;
+  while (num > 0) {
+    size_t filled = chunk_input.requests.size();
+    size_t piece = std::min(get_u() > filled ? get_u() - filled : 1, num);
+    iaf_alg.append_keys(chunk_input.requests, keys, piece);
+    keys += piece;
+    num -= piece;
+    if (chunk_input.requests.size() >= get_u()) process_requests();
+  }
+}
+
+template <typename ChunkOutput>
+void print_result(ChunkOutput& result) {
   std::cout << "living requests" << std::endl;
   for (auto living: result.living_requests)
     std::cout << living.addr << "," << living.access_number << " ";
@@ -55,7 +94,8 @@ void print_result(IncrementAndFreeze::ChunkOutput& result) {
   std::cout << std::endl;
 }
 
-void BoundedIAF::process_requests() {
+template <typename Addr, typename Time, typename Count>
+void BasicBoundedIAF<Addr, Time, Count>::process_requests() {
   STARTTIME(proc_req);
   // std::cout << std::endl;
   // std::cout << "Processing chunk" << std::endl;
@@ -68,6 +108,7 @@ void BoundedIAF::process_requests() {
 
   // auto start = std::chrono::high_resolution_clock::now();
 
+  assert(chunk_input.requests.size() <= Iaf::TimeOp::max_requests);
   iaf_alg.process_chunk(chunk_input);
 
   // update maximum memory usage
@@ -89,6 +130,10 @@ void BoundedIAF::process_requests() {
     result.living_requests.erase(it, it + (size - max_living_req));
   }
 
+  // Keys that are not living are misses when next accessed, so their ids may be reused
+  if (auto* remapper = iaf_alg.get_id_remapper())
+    remapper->recycle(result.living_requests);
+
   // Fix the index of the living requests so they count up from 1
   size_t num_living = 0;
   for (auto &living_req : result.living_requests)
@@ -106,20 +151,20 @@ void BoundedIAF::process_requests() {
   STOPTIME(proc_req);
 }
 
-CacheSim::SuccessVector BoundedIAF::get_success_function() {
+template <typename Addr, typename Time, typename Count>
+CacheSim::SuccessVector BasicBoundedIAF<Addr, Time, Count>::get_success_function() {
   // Ensure all requests processed
   if (chunk_input.requests.size() - chunk_input.output.living_requests.size() > 0) {
     // std::cout << "Processing chunk of size " << chunk_input.requests.size() << " before get_success_function()." << std::endl;
     process_requests();
   }
 
-  // TODO: parallel prefix sum for integrating
-  size_t running_count = 0;
-  CacheSim::SuccessVector success_func(chunk_input.output.hits_vector.size());
-  for (size_t i = 1; i < chunk_input.output.hits_vector.size(); i++) {
-    running_count += chunk_input.output.hits_vector[i];
-    success_func[i] = running_count;
-  }
+  // Integrate the hits vector into the success function. The hits vector keeps
+  // accumulating future chunks so the success function is its only copy.
+  const std::vector<Count>& hits = chunk_input.output.hits_vector;
+  CacheSim::SuccessVector success_func(hits.size());
+  if (hits.size() > 1)
+    parallel_prefix_sum(&hits[1], &success_func[1], hits.size() - 1);
 
   //for (auto& success : success_func)
   //  success /= running_count;
@@ -127,3 +172,6 @@ CacheSim::SuccessVector BoundedIAF::get_success_function() {
   return success_func;
 }
 
+template class BasicBoundedIAF<uint32_t, uint32_t, uint64_t>;
+template class BasicBoundedIAF<uint64_t, uint32_t, uint64_t>;
+template class BasicBoundedIAF<uint64_t, uint64_t, uint64_t>;
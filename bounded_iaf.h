@@ -20,22 +20,35 @@
 #ifndef ONLINE_CACHE_SIMULATOR_INCLUDE_IAKWRAPPER_H_
 #define ONLINE_CACHE_SIMULATOR_INCLUDE_IAKWRAPPER_H_
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <vector>
 #include <utility>
 
 #include "cache_sim.h"
 #include "increment_and_freeze.h"
 
-class BoundedIAF : public CacheSim {
+/*
+ * Runs IncrementAndFreeze upon chunks of the requests, carrying the living requests of each
+ * chunk into the next. Access numbers are renumbered from 1 in every chunk.
+ * Addr, Time, Count: as in BasicIncrementAndFreeze. Count accumulates the hits of every
+ * chunk while Time need only number the requests of a chunk. So 32 bit Time suffices beside
+ * 64 bit ids whenever max_chunk_size() is at most CompactOp::max_requests, and then the requests
+ * take 12 bytes rather than 16 and the ops are always CompactOps.
+ * Instantiated only for the widths declared at the end of this file.
+ */
+template <typename Addr, typename Time, typename Count>
+class BasicBoundedIAF : public CacheSim {
   private:
-    using ChunkInput = IncrementAndFreeze::ChunkInput;
-    using ChunkOutput = IncrementAndFreeze::ChunkOutput;
+    using Iaf = BasicIncrementAndFreeze<Addr, Time, Count>;
+    using ChunkInput = typename Iaf::ChunkInput;
+    using ChunkOutput = typename Iaf::ChunkOutput;
     // Struct that holds hits vector, living requests, and chunk requests to process
     ChunkInput chunk_input;
 
-    IncrementAndFreeze iaf_alg;
+    Iaf iaf_alg;
 
     size_t cur_u;
     size_t max_living_req;
@@ -52,8 +65,30 @@ class BoundedIAF : public CacheSim {
     void process_requests();
 
   public:
+    // max_cache_size that places no limit upon the reported memory sizes
+    constexpr static size_t unlimited_cache = ((size_t)-1)/max_u_mult;
+
+    // Largest chunk, and so the largest number of requests Time must count, when at most
+    // num_ids ids are living and the cache is limited to max_cache_size
+    static size_t max_chunk_size(size_t min_chunk_size, size_t max_cache_size, uint64_t num_ids) {
+      return std::max(min_chunk_size, max_u_mult * std::min<uint64_t>(max_cache_size, num_ids));
+    }
+
     // Logs a memory access to simulate. The order this function is called in matters.
-    void memory_access(req_count_t addr);
+    // Exits if addr does not fit in Addr.
+    void memory_access(uint64_t addr);
+
+    // Logs a memory access to each of num_blocks consecutive ids from first_addr. The extent
+    // is appended to the chunk a piece at a time, processing the chunk whenever it fills.
+    void extent_access(uint64_t first_addr, size_t num_blocks);
+
+    uint64_t get_max_id() const { return std::numeric_limits<Addr>::max(); }
+
+    // Logs a memory access to a 64 bit key, renamed to a dense id. The ids of keys that drop
+    // out of the living requests are recycled after each chunk, so ids stay below the number
+    // of living requests plus the chunk size. Must not be mixed with memory_access().
+    void key_access(uint64_t key);
+    void key_batch_access(const uint64_t* keys, size_t num);
     
     /* Returns the success function after processing requests in the current chunk.
      * Does some work, up to u log u depending on the number of unprocessed requests.
@@ -69,9 +104,20 @@ class BoundedIAF : public CacheSim {
     // max_cache_size: Limit on the memory sizes for which we report the hit rate. For example a 
     //                 max cache size of 1 GiB means that we report hit rate for all memory sizes
     //                 <= 1 GiB.
-    BoundedIAF(size_t min_chunk_size=65536, size_t max_cache_size=((size_t)-1)/max_u_mult) 
-      : cur_u(min_chunk_size), max_living_req(max_cache_size) {};
-    ~BoundedIAF() = default;
+    // config:         Runtime options passed to the underlying IncrementAndFreeze. By default
+    //                 loaded from the tuning profile named by $IAF_TUNING_PROFILE.
+    BasicBoundedIAF(size_t min_chunk_size=65536, size_t max_cache_size=unlimited_cache,
+                    IafConfig config=tuned_config())
+      : iaf_alg(config), cur_u(min_chunk_size), max_living_req(max_cache_size) {};
+    ~BasicBoundedIAF() = default;
 };
 
+extern template class BasicBoundedIAF<uint32_t, uint32_t, uint64_t>;
+extern template class BasicBoundedIAF<uint64_t, uint32_t, uint64_t>;
+extern template class BasicBoundedIAF<uint64_t, uint64_t, uint64_t>;
+
+// BoundedIAF of the default width, see req_count_t. Hits are always counted in 64 bits
+// because they accumulate over every chunk.
+using BoundedIAF = BasicBoundedIAF<req_count_t, req_count_t, uint64_t>;
+
 #endif  // ONLINE_CACHE_SIMULATOR_INCLUDE_BOUNDED_IAF_H_
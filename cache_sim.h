@@ -20,6 +20,7 @@
 #ifndef ONLINE_CACHE_SIMULATOR_CACHE_SIM_H_
 #define ONLINE_CACHE_SIMULATOR_CACHE_SIM_H_
 
+#include <cstdint>      // uint64_t, UINT64_MAX
 #include <iostream>     // std::ostream, std::endl
 #include <vector>       // vector
 #include <iomanip>      // std::setw
@@ -42,7 +43,9 @@ inline uint8_t _depth = 0;
 #define STOPTIME(X)  
 #endif //DEBUG_PERF
 
-// number of bits needed to specify number of requests
+// number of bits needed to specify number of requests. This is the default width of the ids
+// and access numbers of the simulators, which are templates that may be instantiated for
+// other widths. CacheSim itself takes 64 bit ids and reports 64 bit hit counts.
 #ifdef ADDR_BIT32
 typedef uint32_t req_count_t;
 #else
@@ -59,12 +62,25 @@ static inline double percent(double val, double total) {
   return round((val / total) * 1000000) / 10000;
 }
 
+// The block_bytes sized blocks overlapping a byte range
+struct BlockRange {
+  uint64_t first;      // number of the first block
+  uint64_t num_blocks;
+};
+
+// Returns the blocks overlapping the length > 0 bytes at offset
+inline BlockRange byte_range_blocks(uint64_t offset, uint64_t length, uint64_t block_bytes) {
+  assert(block_bytes > 0 && length > 0);
+  uint64_t first = offset / block_bytes;
+  return {first, (offset + length - 1) / block_bytes - first + 1};
+}
+
 class CacheSim {
  protected:
   uint64_t access_number = 1; // simulated timestamp and number of total requests
   size_t memory_usage = 0;    // memory usage of the cache sim
  public:
-  using SuccessVector = std::vector<req_count_t>;
+  using SuccessVector = std::vector<uint64_t>;
 
   CacheSim() = default;
   virtual ~CacheSim() = default;
@@ -73,7 +89,44 @@ class CacheSim {
    * addr:    the id to access 
    * returns  nothing
    */
-  virtual void memory_access(req_count_t addr) = 0;
+  virtual void memory_access(uint64_t addr) = 0;
+
+  /*
+   * Perform a memory access upon a 64 bit key. Simulators that rename keys to dense ids
+   * override this. The others access the key as an id.
+   */
+  virtual void key_access(uint64_t key) { memory_access(key); }
+
+  // key_access() each of num keys in order
+  virtual void key_batch_access(const uint64_t* keys, size_t num) {
+    for (size_t i = 0; i < num; i++)
+      key_access(keys[i]);
+  }
+
+  /*
+   * Perform a memory access upon each of num_blocks consecutive ids in order, such as the
+   * blocks of an I/O extent. Simulators that buffer requests override this to append the
+   * whole extent at once.
+   * first_addr: the id of the first block
+   */
+  virtual void extent_access(uint64_t first_addr, size_t num_blocks) {
+    for (size_t i = 0; i < num_blocks; i++)
+      memory_access(first_addr + i);
+  }
+
+  // Largest id accepted by memory_access() and extent_access()
+  virtual uint64_t get_max_id() const { return UINT64_MAX; }
+
+  /*
+   * Access every block_bytes sized block overlapping the length bytes at offset. The blocks
+   * are numbered from base.
+   */
+  void byte_extent_access(uint64_t offset, uint64_t length, uint64_t block_bytes,
+                          uint64_t base = 0) {
+    if (length == 0) return;
+    BlockRange blocks = byte_range_blocks(offset, length, block_bytes);
+    extent_access(base + blocks.first, blocks.num_blocks);
+  }
 
   virtual SuccessVector get_success_function() = 0;
   
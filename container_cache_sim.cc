@@ -22,7 +22,7 @@
 #include <utility>
 
 // perform a memory access and use the LRU_queue to update the success function
-void ContainerCacheSim::memory_access(req_count_t addr) {
+void ContainerCacheSim::memory_access(uint64_t addr) {
   uint64_t ts = access_number++;
 
   // attempt to find the addr in the OSTree
@@ -58,7 +58,7 @@ uint64_t ContainerCacheSim::move_front_queue(uint64_t old_ts, uint64_t new_ts) {
 // return the success function by starting at the back of the
 // page_hits vector and summing the elements to the front
 CacheSim::SuccessVector ContainerCacheSim::get_success_function() {
-  req_count_t nhits = 0;
+  uint64_t nhits = 0;
 
   // update the memory usage of the OSTreeSim
   memory_usage = LRU_queue.size() * sizeof(cachelib::OrderStatisticSet<size_t, std::greater<>>::node_type);
@@ -38,7 +38,7 @@ class ContainerCacheSim : public CacheSim {
  private:
   std::vector<req_count_t> page_hits;  // vector used to construct success function
   cachelib::OrderStatisticSet<uint64_t, std::greater<>> LRU_queue; // order statistics tree for LRU depth
-  std::unordered_map<req_count_t, uint64_t> page_table;  // map from addr to ts
+  std::unordered_map<uint64_t, uint64_t> page_table;  // map from addr to ts
  public:
   ContainerCacheSim() = default;
   ~ContainerCacheSim() = default;
@@ -50,7 +50,7 @@ class ContainerCacheSim : public CacheSim {
    * virtual_addr:   the virtual address to access
    * returns         nothing
    */
-  void memory_access(req_count_t addr);
+  void memory_access(uint64_t addr);
 
   /*
    * Moves a page with a given timestamp to the front of the queue
@@ -0,0 +1,308 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "csv_trace.h"
+
+#include <immintrin.h>
+#include <omp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <cstring>
+
+#include "base_case.h"    // for detect_simd_level
+#include "trace_format.h" // for map_file, release_pages
+
+// Ranges are scanned for separators 64 bytes at a time. This file is compiled for the
+// baseline instruction set, the wider scans are only reached if detect_simd_level() allows.
+namespace {
+constexpr size_t kScanBytes = 64;
+
+// Each Scan struct provides separators(p, delim), whose bit i is set if p[i] is delim or a
+// newline, for the kScanBytes bytes at p.
+struct ScalarScan {
+  static inline uint64_t separators(const char* p, char delim, size_t len = kScanBytes) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < len; i++)
+      mask |= (uint64_t)(p[i] == delim || p[i] == '\n') << i;
+    return mask;
+  }
+};
+
+struct Sse42Scan {
+  __attribute__((target("sse4.2")))
+  static inline uint64_t separators(const char* p, char delim) {
+    const __m128i d = _mm_set1_epi8(delim);
+    const __m128i nl = _mm_set1_epi8('\n');
+    uint64_t mask = 0;
+    for (size_t i = 0; i < kScanBytes; i += 16) {
+      __m128i bytes = _mm_loadu_si128((const __m128i*)(p + i));
+      __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(bytes, d), _mm_cmpeq_epi8(bytes, nl));
+      mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(hits) << i;
+    }
+    return mask;
+  }
+};
+
+struct Avx2Scan {
+  __attribute__((target("avx2")))
+  static inline uint64_t separators(const char* p, char delim) {
+    const __m256i d = _mm256_set1_epi8(delim);
+    const __m256i nl = _mm256_set1_epi8('\n');
+    __m256i lo = _mm256_loadu_si256((const __m256i*)p);
+    __m256i hi = _mm256_loadu_si256((const __m256i*)(p + 32));
+    uint32_t lo_mask = _mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(lo, d), _mm256_cmpeq_epi8(lo, nl)));
+    uint32_t hi_mask = _mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(hi, d), _mm256_cmpeq_epi8(hi, nl)));
+    return lo_mask | (uint64_t)hi_mask << 32;
+  }
+};
+
+struct Field {
+  const char* begin;
+  const char* end;
+};
+
+// Trim the whitespace, such as the \r of a \r\n line ending, around a field
+inline Field trim(Field field) {
+  while (field.begin < field.end && (*field.begin == ' ' || *field.begin == '\t'))
+    ++field.begin;
+  while (field.end > field.begin && (field.end[-1] == ' ' || field.end[-1] == '\r'
+                                     || field.end[-1] == '\t'))
+    --field.end;
+  return field;
+}
+
+inline bool parse_number(Field field, uint64_t& value) {
+  field = trim(field);
+  auto [next, err] = std::from_chars(field.begin, field.end, value);
+  return field.begin < field.end && err == std::errc() && next == field.end;
+}
+
+inline uint64_t hash_bytes(const char* p, size_t len) {
+  uint64_t h = len * 0x9E3779B97F4A7C15ull;
+  uint64_t word;
+  for (; len >= 8; p += 8, len -= 8) {
+    memcpy(&word, p, 8);
+    h = (h ^ word) * 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 31;
+  }
+  word = 0;
+  memcpy(&word, p, len);
+  h = (h ^ word) * 0x94d049bb133111ebull;
+  return h ^ (h >> 29);
+}
+
+// Integer ids keep their value, any other non-empty id is hashed
+inline bool parse_id(Field field, uint64_t& id) {
+  field = trim(field);
+  if (field.begin == field.end) return false;
+  if (!parse_number(field, id)) id = hash_bytes(field.begin, field.end - field.begin);
+  return true;
+}
+
+// The rows of a range. Key-value rows are parsed to keys, which CacheSim::key_batch_access()
+// may rename, and block rows to extents, which CacheSim::extent_access() expands.
+struct ParsedRange {
+  struct Extent {
+    uint64_t first_addr;
+    uint64_t num_blocks;
+  };
+  std::vector<uint64_t> keys;
+  std::vector<Extent> extents;
+  uint64_t rows;
+  uint64_t accesses;
+  const char* error; // first malformed row
+};
+
+// Append the accesses of a row of num_fields fields to out. Returns false if it is malformed.
+inline bool parse_row(const Field* fields, size_t num_fields, const CsvTraceConfig& config,
+                      ParsedRange& out) {
+  if (config.kind == KV_TRACE) {
+    uint64_t key;
+    if (config.key_column >= num_fields || !parse_id(fields[config.key_column], key))
+      return false;
+    out.keys.push_back(key);
+    ++out.accesses;
+  } else {
+    uint64_t disk, offset, length;
+    size_t last_column = std::max(config.disk_column,
+                                  std::max(config.offset_column, config.length_column));
+    if (last_column >= num_fields || !parse_id(fields[config.disk_column], disk)
+        || !parse_number(fields[config.offset_column], offset)
+        || !parse_number(fields[config.length_column], length))
+      return false;
+    if (length > 0) {
+      BlockRange blocks = byte_range_blocks(offset, length, config.block_bytes);
+      out.extents.push_back({block_address(disk, blocks.first), blocks.num_blocks});
+      out.accesses += blocks.num_blocks;
+    }
+  }
+  ++out.rows;
+  return true;
+}
+
+// Parse the rows of [begin, end), which begins a line and ends one or the file, into out.
+// Returns false with out.error at the first malformed row.
+template <typename Scan>
+bool parse_range(const char* begin, const char* end, const CsvTraceConfig& config,
+                 ParsedRange& out) {
+  Field fields[kMaxCsvColumns];
+  size_t column = 0;
+  const char* field_start = begin;
+  const char* row_start = begin;
+
+  // The field ending at sep. If it ends the row, parse the row.
+  auto end_field = [&](const char* sep) {
+    if (column < kMaxCsvColumns) fields[column] = {field_start, sep};
+    ++column;
+    field_start = sep + 1;
+    if (sep < end && *sep != '\n') return true;
+
+    // blank lines hold no accesses
+    bool blank = column == 1 && trim(fields[0]).begin == trim(fields[0]).end;
+    if (!blank && !parse_row(fields, std::min(column, kMaxCsvColumns), config, out)) {
+      out.error = row_start;
+      return false;
+    }
+    column = 0;
+    row_start = field_start;
+    return true;
+  };
+
+  const char* block = begin;
+  for (; end - block >= (ptrdiff_t) kScanBytes; block += kScanBytes) {
+    uint64_t mask = Scan::separators(block, config.delimiter);
+    for (; mask != 0; mask &= mask - 1)
+      if (!end_field(block + __builtin_ctzll(mask))) return false;
+  }
+  uint64_t mask = ScalarScan::separators(block, config.delimiter, end - block);
+  for (; mask != 0; mask &= mask - 1)
+    if (!end_field(block + __builtin_ctzll(mask))) return false;
+
+  // the last row of the file need not end with a newline, and may end with an empty field
+  if (column > 0 || field_start < end) return end_field(end);
+  return true;
+}
+
+using RangeParser = bool (*)(const char* begin, const char* end, const CsvTraceConfig& config,
+                             ParsedRange& out);
+
+__attribute__((flatten))
+bool scalar_parse_range(const char* begin, const char* end, const CsvTraceConfig& config,
+                        ParsedRange& out) {
+  return parse_range<ScalarScan>(begin, end, config, out);
+}
+
+__attribute__((target("sse4.2"), flatten))
+bool sse42_parse_range(const char* begin, const char* end, const CsvTraceConfig& config,
+                       ParsedRange& out) {
+  return parse_range<Sse42Scan>(begin, end, config, out);
+}
+
+__attribute__((target("avx2"), flatten))
+bool avx2_parse_range(const char* begin, const char* end, const CsvTraceConfig& config,
+                      ParsedRange& out) {
+  return parse_range<Avx2Scan>(begin, end, config, out);
+}
+
+RangeParser range_parser() {
+  switch (detect_simd_level()) {
+    case SIMD_SCALAR: return scalar_parse_range;
+    case SIMD_SSE42:  return sse42_parse_range;
+    default:          return avx2_parse_range;
+  }
+}
+}  // namespace
+
+CsvTraceReader::CsvTraceReader(CsvTraceConfig config) : config(config) {
+  assert(config.block_bytes > 0);
+  assert(config.delimiter != '\n');
+}
+
+CsvTraceReader::~CsvTraceReader() {
+  if (data != nullptr) munmap((void*) data, size);
+}
+
+bool CsvTraceReader::open(const std::string& path) {
+  data = (const char*) map_file(path, size);
+  if (data != nullptr) return true;
+
+  // an empty trace cannot be mapped but holds no rows
+  struct stat file_stat;
+  size = 0;
+  return stat(path.c_str(), &file_stat) == 0 && file_stat.st_size == 0;
+}
+
+bool CsvTraceReader::replay(CacheSim& sim) {
+  const RangeParser parse = range_parser();
+  const char* end = data + size;
+  const char* pos = data;
+  if (config.header) {
+    pos = (const char*) memchr(data, '\n', size);
+    pos = pos == nullptr ? end : pos + 1;
+  }
+
+  const size_t window = kCsvRangesPerThread * omp_get_max_threads();
+  std::vector<const char*> bounds(window + 1);
+  std::vector<ParsedRange> parsed(window);
+  std::vector<char> ok(window);
+  while (pos < end) {
+    // split the next window into ranges that end just after a newline
+    size_t num_ranges = 0;
+    bounds[0] = pos;
+    while (num_ranges < window && bounds[num_ranges] < end) {
+      const char* split = bounds[num_ranges] + kCsvRangeBytes;
+      if (split >= end) split = end;
+      else {
+        split = (const char*) memchr(split, '\n', end - split);
+        split = split == nullptr ? end : split + 1;
+      }
+      bounds[++num_ranges] = split;
+    }
+
+#pragma omp parallel for schedule(dynamic)
+    for (size_t r = 0; r < num_ranges; r++) {
+      parsed[r].keys.clear();
+      parsed[r].extents.clear();
+      parsed[r].rows = parsed[r].accesses = 0;
+      ok[r] = parse(bounds[r], bounds[r + 1], config, parsed[r]);
+    }
+
+    for (size_t r = 0; r < num_ranges; r++) {
+      sim.key_batch_access(parsed[r].keys.data(), parsed[r].keys.size());
+      for (auto extent : parsed[r].extents)
+        sim.extent_access(extent.first_addr, extent.num_blocks);
+      num_accesses += parsed[r].accesses;
+      num_rows += parsed[r].rows;
+      if (!ok[r]) {
+        error_offset = parsed[r].error - data;
+        return false;
+      }
+    }
+    release_pages(data, pos - data, bounds[num_ranges] - data);
+    pos = bounds[num_ranges];
+  }
+  return true;
+}
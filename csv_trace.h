@@ -0,0 +1,100 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef ONLINE_CACHE_SIMULATOR_CSV_TRACE_H_
+#define ONLINE_CACHE_SIMULATOR_CSV_TRACE_H_
+
+#include <cstddef>     // for size_t
+#include <cstdint>     // for uint64_t
+#include <string>      // for string
+#include <vector>      // for vector
+
+#include "cache_sim.h" // for CacheSim
+
+// The kinds of rows of a CSV trace
+enum CsvTraceKind {
+  KV_TRACE,    // key-value cache log: each row accesses one key
+  BLOCK_TRACE, // block I/O trace: each row accesses every block of an extent of a disk
+};
+
+// Columns at or beyond this are ignored
+constexpr size_t kMaxCsvColumns = 16;
+
+// Bytes parsed by a single task, and tasks per thread parsed before their rows are fed
+constexpr size_t kCsvRangeBytes = 1 << 20;
+constexpr size_t kCsvRangesPerThread = 4;
+
+/*
+ * Layout of a CSV trace. The defaults match key-value logs of (timestamp, key, size, op)
+ * and block traces of (timestamp, disk, offset, length, type). Only the named columns are
+ * parsed, other columns may hold anything but the delimiter. Fields are not quoted.
+ * Keys and disks that are not integers are hashed to 64 bits.
+ */
+struct CsvTraceConfig {
+  CsvTraceKind kind = KV_TRACE;
+  char delimiter = ',';
+  bool header = false;      // If the first line names the columns
+  size_t key_column = 1;    // KV_TRACE
+  size_t disk_column = 1;   // BLOCK_TRACE
+  size_t offset_column = 2; // BLOCK_TRACE, in bytes
+  size_t length_column = 3; // BLOCK_TRACE, in bytes
+  size_t block_bytes = 4096;
+};
+
+// Address of block of disk. Disks are offset from one another by a hash of the disk, so the
+// addresses are spread over all 64 bits.
+inline uint64_t block_address(uint64_t disk, uint64_t block) {
+  return disk * 0x9E3779B97F4A7C15ull + block;
+}
+
+/*
+ * Reads a CSV trace through a read only mapping. The file is split into ranges that end at
+ * newlines, which are parsed in parallel with SIMD scans for delimiters and newlines. The
+ * addresses of each window of ranges are then fed to the CacheSim in trace order.
+ */
+class CsvTraceReader {
+ private:
+  CsvTraceConfig config;
+  const char* data = nullptr;
+  size_t size = 0;
+  uint64_t num_rows = 0;
+  uint64_t num_accesses = 0;
+  uint64_t error_offset = UINT64_MAX;
+ public:
+  CsvTraceReader(CsvTraceConfig config = CsvTraceConfig());
+  ~CsvTraceReader();
+  CsvTraceReader(const CsvTraceReader&) = delete;
+  CsvTraceReader& operator=(const CsvTraceReader&) = delete;
+
+  // Map the trace at path. Returns false if it could not be read.
+  bool open(const std::string& path);
+
+  // Feed the accesses of every row to sim.memory_access() in order. Returns false at the
+  // first row missing a column or holding a malformed number.
+  bool replay(CacheSim& sim);
+
+  uint64_t get_num_rows() const { return num_rows; }
+  uint64_t get_num_accesses() const { return num_accesses; }
+
+  // Byte offset in the file of the first malformed row, or UINT64_MAX if there is none
+  uint64_t get_error_offset() const { return error_offset; }
+};
+
+#endif  // ONLINE_CACHE_SIMULATOR_CSV_TRACE_H_
@@ -0,0 +1,96 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "container_cache_sim.h"
+#include "csv_trace.h"
+#include "increment_and_freeze.h"
+#include "test_traces.h"
+
+TEST(CsvTraceTests, CsvTraceReader) {
+  // enough rows for many ranges, whose keys are integers or strings
+  std::vector<req_count_t> trace = skewed_trace(300'000, 5'000, 45);
+  std::vector<req_count_t> expected_trace;
+  std::string path = testing::TempDir() + "/iaf_kv.csv";
+  {
+    std::ofstream out(path);
+    out << "timestamp,key,size,op\r\n";
+    for (size_t i = 0; i < trace.size(); i++) {
+      out << i << ",";
+      if (trace[i] % 2) out << trace[i];
+      else out << "k" << trace[i];
+      out << "," << i % 100 << ",get" << (i + 1 < trace.size() ? "\r\n" : "");
+    }
+  }
+  // string keys are hashed, which only renames them
+  for (auto addr : trace)
+    expected_trace.push_back(addr % 2 ? addr : (req_count_t)-1 - addr);
+
+  CsvTraceConfig config;
+  config.header = true;
+  CsvTraceReader reader(config);
+  ASSERT_TRUE(reader.open(path));
+  IncrementAndFreeze direct, replayed;
+  ASSERT_TRUE(reader.replay(replayed));
+  ASSERT_EQ(reader.get_num_rows(), trace.size());
+  ASSERT_EQ(replayed.get_success_function(), run_trace(direct, expected_trace));
+
+  // a last row without a newline counts even when it ends with an empty field
+  std::ofstream(path) << "0,5,1,get\n1,5,1,get,";
+  CsvTraceReader trailing_reader(CsvTraceConfig{});
+  ASSERT_TRUE(trailing_reader.open(path));
+  ContainerCacheSim trailing;
+  ASSERT_TRUE(trailing_reader.replay(trailing));
+  ASSERT_EQ(trailing_reader.get_num_rows(), 2);
+  ASSERT_EQ(trailing.get_success_function()[1], 1);
+
+  // extents touch every block they overlap
+  std::ofstream(path) << "0,3,4096,8192,R\n1,3,4095,2,W\n\n2,4,0,0,R\n3,x,0,1,R\n";
+  config = CsvTraceConfig();
+  config.kind = BLOCK_TRACE;
+  CsvTraceReader block_reader(config);
+  ASSERT_TRUE(block_reader.open(path));
+  ContainerCacheSim blocks;
+  ASSERT_TRUE(block_reader.replay(blocks));
+  ASSERT_EQ(block_reader.get_num_rows(), 4);
+  ASSERT_EQ(block_reader.get_num_accesses(), 5);
+  CacheSim::SuccessVector block_success = blocks.get_success_function();
+  ASSERT_EQ(block_success[2], 0); // accesses blocks 1, 2, 0, 1 of disk 3
+  ASSERT_EQ(block_success[3], 1);
+
+  // disks whose hashes agree in their low 32 bits are still distinct
+  std::ofstream(path) << "0,3,0,1,R\n1,4294967299,0,1,R\n";
+  CsvTraceReader wide_reader(config);
+  ASSERT_TRUE(wide_reader.open(path));
+  ContainerCacheSim wide_blocks;
+  ASSERT_TRUE(wide_reader.replay(wide_blocks));
+  ASSERT_GT(block_address(3, 0), UINT32_MAX);
+  ASSERT_EQ(wide_blocks.get_success_function()[1], 0);
+
+  std::ofstream(path) << "0,3,4096,8192,R\n1,3,x,2,W\n";
+  CsvTraceReader bad_reader(config);
+  ASSERT_TRUE(bad_reader.open(path));
+  ASSERT_FALSE(bad_reader.replay(blocks));
+  ASSERT_EQ(bad_reader.get_error_offset(), 16);
+}
@@ -22,12 +22,21 @@
 #include <random>
 #include <string>
 #include <vector>
-#include <fstream>
 
 #include "params.h"
+#include "workload.h"
 #include "cache_sim.h"
+#include "trace_format.h"
 
-void uniform_trace(std::ofstream& out, uint64_t seed) {
+// Finish writing a trace, exit if it could not be written
+void close_trace(TraceWriter& out) {
+  if (!out.close()) {
+    std::cerr << "ERROR: Could not write trace" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+void uniform_trace(TraceWriter& out, uint64_t seed) {
   std::mt19937_64 rand(seed);
   std::cout << "Dumping Trace...  0%       \r"; fflush(stdout);
   size_t half_percent = kAccesses / 200;
@@ -39,46 +48,12 @@ void uniform_trace(std::ofstream& out, uint64_t seed) {
       std::cout << "Dumping Trace...  " << (float)cur_half/2 << "%        \r"; fflush(stdout);
       last_print = i;
     }
-    out << (req_count_t)rand() % kIdUniverseSize << std::endl;
+    out.append((req_count_t)rand() % kIdUniverseSize);
   } 
 }
 
-void zipfian_trace(std::ofstream& out, uint64_t seed, double alpha) {
-  std::mt19937_64 rand(seed); // create random number generator
-  std::vector<double> freq_vec;
-  freq_vec.reserve(kIdUniverseSize);
-  // generate the divisor
-  double divisor = 0;
-  for (uint64_t i = 1; i < kIdUniverseSize + 1; i++) {
-    divisor += 1 / pow(i, alpha);
-  }
-
-  // now for each id calculate it's normalized frequency
-  for (uint64_t i = 1; i < kIdUniverseSize + 1; i++)
-    freq_vec.push_back((1 / pow(i, alpha)) / divisor);
-
-  // now push to sequence vector based upon frequency
-  std::vector<req_count_t> seq_vec;
-  seq_vec.reserve(kAccesses);
-  for (uint64_t i = 0; i < kIdUniverseSize; i++) {
-    uint64_t num_items = round(freq_vec[i] * kAccesses);
-    // zipf_hist << i << ":" << num_items << std::endl;
-    for (uint64_t j = 0; j < num_items && seq_vec.size() < kAccesses; j++)
-      seq_vec.push_back(i);
-  }
-
-  // if we have too few accesses make up for it by adding more to most common
-  if (seq_vec.size() < kAccesses) {
-    uint64_t num_needed = kAccesses - seq_vec.size();
-    for (uint64_t i = 0; i < num_needed; i++)
-      seq_vec.push_back(i % kIdUniverseSize);
-  }
-
-  seq_vec.resize(kAccesses);
-
-  // shuffle the sequence vector
-  std::shuffle(seq_vec.begin(), seq_vec.end(), rand);
-  // std::cout << "Zipfian sequence memory impact: " << seq_vec.size() * sizeof(uint64_t)/1024/1024 << "MiB" << std::endl;
+void zipfian_trace(TraceWriter& out, uint64_t seed, double alpha) {
+  std::vector<uint64_t> seq_vec = generate_zipf(seed, alpha);
 
   std::cout << "Dumping Trace...  0%       \r"; fflush(stdout);
   size_t half_percent = kAccesses / 200;
@@ -90,7 +65,7 @@ void zipfian_trace(std::ofstream& out, uint64_t seed, double alpha) {
       std::cout << "Dumping Trace...  " << (float)cur_half/2 << "%        \r"; fflush(stdout);
       last_print = i;
     }
-    out << seq_vec[i] << std::endl;
+    out.append(seq_vec[i]);
   } 
 }
 
@@ -108,32 +83,38 @@ int main(int argc, char** argv) {
   // dump traces to files
   {
     std::cout << "Uniform access trace" << std::endl;
-    std::ofstream out(dir + "uniform.trace");
+    TraceWriter out(dir + "uniform" + kTraceExtension);
     uniform_trace(out, kSeed);
+    close_trace(out);
   }
   {
     std::cout << "Zipfian access trace 0.1" << std::endl;
-    std::ofstream out(dir + "zipfian_0.1.trace");
+    TraceWriter out(dir + "zipfian_0.1" + kTraceExtension);
     zipfian_trace(out, kSeed, 0.1);
+    close_trace(out);
   }
   {
     std::cout << "Zipfian access trace 0.2" << std::endl;
-    std::ofstream out(dir + "zipfian_0.2.trace");
+    TraceWriter out(dir + "zipfian_0.2" + kTraceExtension);
     zipfian_trace(out, kSeed, 0.2);
+    close_trace(out);
   }
   {
     std::cout << "Zipfian access trace 0.4" << std::endl;
-    std::ofstream out(dir + "zipfian_0.4.trace");
+    TraceWriter out(dir + "zipfian_0.4" + kTraceExtension);
     zipfian_trace(out, kSeed, 0.4);
+    close_trace(out);
   }
   {
     std::cout << "Zipfian access trace 0.6" << std::endl;
-    std::ofstream out(dir + "zipfian_0.6.trace");
+    TraceWriter out(dir + "zipfian_0.6" + kTraceExtension);
     zipfian_trace(out, kSeed, 0.6);
+    close_trace(out);
   }
   {
     std::cout << "Zipfian access trace 0.8" << std::endl;
-    std::ofstream out(dir + "zipfian_0.8.trace");
+    TraceWriter out(dir + "zipfian_0.8" + kTraceExtension);
     zipfian_trace(out, kSeed, 0.8);
+    close_trace(out);
   }
 }
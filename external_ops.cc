@@ -0,0 +1,284 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "external_ops.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <utility>
+
+#include "radix_sort.h"
+
+// Report a failed system call upon what and exit
+[[noreturn]] static void io_error(const std::string& what) {
+  std::cerr << "ERROR: External op builder could not " << what << ": " << strerror(errno)
+            << std::endl;
+  exit(EXIT_FAILURE);
+}
+
+static void write_all(int fd, const void* data, size_t bytes, uint64_t offset) {
+  const char* ptr = (const char*) data;
+  while (bytes > 0) {
+    ssize_t written = pwrite(fd, ptr, bytes, offset);
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) io_error("write");
+    ptr += written;
+    bytes -= written;
+    offset += written;
+  }
+}
+
+static void read_all(int fd, void* data, size_t bytes, uint64_t offset) {
+  char* ptr = (char*) data;
+  while (bytes > 0) {
+    ssize_t got = pread(fd, ptr, bytes, offset);
+    if (got < 0 && errno == EINTR) continue;
+    if (got <= 0) io_error("read");
+    ptr += got;
+    bytes -= got;
+    offset += got;
+  }
+}
+
+// A file of elements in dir that is unlinked as soon as it is created, so it is removed
+// once closed even if the process dies. Elements are appended and then read back in order.
+class SpillFile {
+ private:
+  int fd;
+  uint64_t bytes = 0;
+ public:
+  SpillFile(const std::string& dir) {
+    std::string path = dir + "/iaf_spill_XXXXXX";
+    fd = mkstemp(path.data());
+    if (fd < 0) io_error("create a spill file in " + dir);
+    unlink(path.c_str());
+  }
+  ~SpillFile() { close(fd); }
+  SpillFile(const SpillFile&) = delete;
+  SpillFile& operator=(const SpillFile&) = delete;
+
+  void append(const void* data, size_t len) {
+    write_all(fd, data, len, bytes);
+    bytes += len;
+  }
+  uint64_t size() const { return bytes; }
+  int descriptor() const { return fd; }
+};
+
+// Reads the elements of a SpillFile in order through a buffer of buffer_elms elements
+template <typename T>
+class RunReader {
+ private:
+  const SpillFile* file;
+  std::vector<T> buffer;
+  size_t pos = 0;
+  size_t len = 0;
+  uint64_t offset = 0;
+
+  void refill() {
+    uint64_t remaining = (file->size() - offset) / sizeof(T);
+    len = std::min((uint64_t) buffer.size(), remaining);
+    read_all(file->descriptor(), buffer.data(), len * sizeof(T), offset);
+    offset += len * sizeof(T);
+    pos = 0;
+  }
+ public:
+  RunReader(const SpillFile* file, size_t buffer_elms)
+      : file(file), buffer(std::max(buffer_elms, (size_t) 1)) { refill(); }
+
+  bool empty() const { return pos == len; }
+  const T& peek() const { return buffer[pos]; }
+  void pop() {
+    if (++pos == len && offset < file->size()) refill();
+  }
+};
+
+// Elements buffered per reader when merging num_runs runs within budget bytes
+template <typename T>
+static size_t reader_elms(size_t budget, size_t num_runs) {
+  return std::max(budget / std::max(num_runs, (size_t) 1), kExternalMinBuffer) / sizeof(T);
+}
+
+bool read_op_file_header(const std::string& path, OpFileHeader& header) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  ssize_t got = pread(fd, &header, sizeof(header), 0);
+  close(fd);
+  return got == (ssize_t) sizeof(header) && header.magic == kOpFileMagic;
+}
+
+ExternalOpBuilder::ExternalOpBuilder(const std::string& scratch_dir, size_t memory_budget,
+                                     IafConfig config)
+    : config(config), scratch_dir(scratch_dir), memory_budget(memory_budget),
+      // sorting a run needs scratch space as large as the run
+      run_capacity(std::max(memory_budget / 2, kExternalMinBuffer) / sizeof(request)) {}
+
+ExternalOpBuilder::~ExternalOpBuilder() = default;
+
+void ExternalOpBuilder::memory_access(req_count_t addr) {
+  // the access numbers of the ops, and so of the requests, are bounded by Op::max_requests
+  if (access_number == Op::max_requests) {
+    std::cerr << "ERROR: External op builder holds at most " << Op::max_requests
+              << " requests between builds" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  ++access_number;
+  run_buffer.push_back({addr, access_number});
+  if (run_buffer.size() >= run_capacity) spill_requests();
+}
+
+void ExternalOpBuilder::spill_requests() {
+  if (run_buffer.empty()) return;
+  STARTTIME(spill_requests);
+  IncrementAndFreeze::sort_requests(run_buffer, config.sort_engine);
+  request_runs.emplace_back(new SpillFile(scratch_dir));
+  request_runs.back()->append(run_buffer.data(), run_buffer.size() * sizeof(request));
+  bytes_spilled += run_buffer.size() * sizeof(request);
+  run_buffer.clear();
+  STOPTIME(spill_requests);
+}
+
+req_count_t ExternalOpBuilder::find_last_accesses(
+    std::vector<std::unique_ptr<SpillFile>>& pair_runs) {
+  // Half of the budget buffers the request runs. The other half holds pairs and the
+  // scratch space to sort them.
+  std::vector<RunReader<request>> readers;
+  for (auto& run : request_runs)
+    readers.emplace_back(run.get(), reader_elms<request>(memory_budget / 2, request_runs.size()));
+
+  std::vector<AccessPair> pairs;
+  std::vector<AccessPair> scratch;
+  const size_t pair_capacity =
+      std::max(memory_budget / 4, kExternalMinBuffer) / sizeof(AccessPair);
+  const size_t time_bits = num_bits(access_number);
+  auto spill_pairs = [&]() {
+    if (pairs.empty()) return;
+    parallel_radix_sort(pairs, scratch, 0, time_bits,
+                        [](const AccessPair& p) { return p.access_number; });
+    pair_runs.emplace_back(new SpillFile(scratch_dir));
+    pair_runs.back()->append(pairs.data(), pairs.size() * sizeof(AccessPair));
+    bytes_spilled += pairs.size() * sizeof(AccessPair);
+    pairs.clear();
+  };
+
+  // k-way merge of the runs by (addr, access_number)
+  using Head = std::pair<request, size_t>;
+  auto greater = [](const Head& l, const Head& r) { return r.first < l.first; };
+  std::priority_queue<Head, std::vector<Head>, decltype(greater)> heads(greater);
+  for (size_t r = 0; r < readers.size(); r++)
+    if (!readers[r].empty()) heads.push({readers[r].peek(), r});
+
+  req_count_t unique_ids = 0;
+  request prev(0, 0);
+  while (!heads.empty()) {
+    auto [req, r] = heads.top();
+    heads.pop();
+    readers[r].pop();
+    if (!readers[r].empty()) heads.push({readers[r].peek(), r});
+
+    if (prev.access_number > 0 && req.addr == prev.addr) {
+      pairs.push_back({req.access_number, prev.access_number});
+      if (pairs.size() >= pair_capacity) spill_pairs();
+    }
+    else
+      ++unique_ids;
+    prev = req;
+  }
+  spill_pairs();
+  return unique_ids;
+}
+
+template <typename OpT>
+uint64_t ExternalOpBuilder::write_operations(std::vector<std::unique_ptr<SpillFile>>& pair_runs,
+                                             int fd) {
+  std::vector<RunReader<AccessPair>> readers;
+  for (auto& run : pair_runs)
+    readers.emplace_back(run.get(), reader_elms<AccessPair>(memory_budget / 2, pair_runs.size()));
+
+  // Pairs have distinct access numbers so the runs are merged upon access_number alone
+  using Head = std::pair<req_count_t, size_t>;
+  std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+  for (size_t r = 0; r < readers.size(); r++)
+    if (!readers[r].empty()) heads.push({readers[r].peek().access_number, r});
+
+  std::vector<OpT> out;
+  out.reserve(std::max(memory_budget / 2, kExternalMinBuffer) / sizeof(OpT));
+  uint64_t offset = kOpFileDataOffset;
+  auto flush = [&]() {
+    write_all(fd, out.data(), out.size() * sizeof(OpT), offset);
+    offset += out.size() * sizeof(OpT);
+    out.clear();
+  };
+
+  // Every request creates a Prefix and, if it has a previous access, a Postfix.
+  // This matches IncrementAndFreeze::emit_operations.
+  for (uint64_t access_num = 1; access_num <= access_number; access_num++) {
+    if (!heads.empty() && heads.top().first == access_num) {
+      size_t r = heads.top().second;
+      heads.pop();
+      req_count_t last_access = readers[r].peek().last_access;
+      readers[r].pop();
+      if (!readers[r].empty()) heads.push({readers[r].peek().access_number, r});
+
+      out.emplace_back(access_num-1, -1);   // Prefix  i-1, +1, Full -1
+      out.emplace_back(last_access);        // Postfix prev(i), +1, Full 0
+    }
+    else
+      out.emplace_back(access_num-1, 0);    // Prefix  i-1, +1, Full 0
+    if (out.size() + 2 > out.capacity()) flush();
+  }
+  if (access_number == 0) out.emplace_back(); // at least the leading Null
+  flush();
+  return (offset - kOpFileDataOffset) / sizeof(OpT);
+}
+
+OpFileHeader ExternalOpBuilder::build(const std::string& op_path) {
+  STARTTIME(external_build);
+  spill_requests();
+  std::vector<request>().swap(run_buffer);
+
+  STARTTIME(find_last_accesses);
+  std::vector<std::unique_ptr<SpillFile>> pair_runs;
+  OpFileHeader header;
+  header.num_requests = access_number;
+  header.unique_ids = find_last_accesses(pair_runs);
+  request_runs.clear();
+  STOPTIME(find_last_accesses);
+
+  STARTTIME(write_operations);
+  int fd = open(op_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) io_error("open " + op_path);
+  header.compact_ops = config.op_encoding == COMPACT_OPS
+                       && access_number <= CompactOp::max_requests;
+  header.num_ops = header.compact_ops ? write_operations<CompactOp>(pair_runs, fd)
+                                      : write_operations<Op>(pair_runs, fd);
+  write_all(fd, &header, sizeof(header), 0);
+  if (close(fd) != 0) io_error("close " + op_path);
+  STOPTIME(write_operations);
+
+  access_number = 0;
+  STOPTIME(external_build);
+  return header;
+}
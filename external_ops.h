@@ -0,0 +1,135 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef ONLINE_CACHE_SIMULATOR_EXTERNAL_OPS_H_
+#define ONLINE_CACHE_SIMULATOR_EXTERNAL_OPS_H_
+
+#include <cstddef>      // for size_t
+#include <cstdint>      // for uint64_t
+#include <memory>       // for unique_ptr
+#include <string>       // for string
+#include <vector>       // for vector
+
+#include "cache_sim.h"  // for req_count_t
+#include "iaf_params.h" // for IafConfig
+#include "increment_and_freeze.h" // for IncrementAndFreeze::request
+#include "tuning_profile.h" // for tuned_config
+
+// Identifies an op file, "IAFOPS" followed by the format version
+constexpr uint64_t kOpFileMagic = 0x0001'5350'4f46'4149;
+
+// The operations of an op file begin at this offset so that they may be mapped page aligned
+constexpr size_t kOpFileDataOffset = 4096;
+
+// Smallest buffer used to read or write a spilled file, smaller budgets are rounded up
+constexpr size_t kExternalMinBuffer = 1 << 16;
+
+// Header at the beginning of an op file. It is followed by num_ops operations of the
+// IncrementAndFreeze of num_requests requests, in the same order as they are built in memory.
+struct OpFileHeader {
+  uint64_t magic = kOpFileMagic;
+  uint64_t num_requests = 0;
+  uint64_t num_ops = 0;
+  uint64_t unique_ids = 0;
+  uint64_t compact_ops = 0; // the operations are CompactOps if 1, Ops if 0
+};
+
+// I/O of IncrementAndFreeze::get_success_function() upon an op file. Under the external
+// memory model each level of the recursion above the paged in projections streams every
+// operation once, so streamed_bytes grows with log of the number of operations.
+struct ExternalIoStats {
+  uint64_t streamed_bytes = 0;  // bytes of operations partitioned within the mapping
+  uint64_t mapped_nodes = 0;    // projections partitioned within the mapping
+  uint64_t paged_in_bytes = 0;  // bytes of operations copied into memory to be solved
+  uint64_t paged_in_projections = 0;
+  uint64_t block_reads = 0;     // file system blocks read and written, from getrusage
+  uint64_t block_writes = 0;
+};
+
+// Read the header of the op file at path. Returns false if the file cannot be read or
+// is not an op file.
+bool read_op_file_header(const std::string& path, OpFileHeader& header);
+
+class SpillFile;
+
+/*
+ * Builds the operations of IncrementAndFreeze for traces that do not fit in memory.
+ * Requests are buffered until memory_budget is reached, sorted by (addr, access_number),
+ * and spilled to a run file in scratch_dir. build() then merges the runs to find the
+ * previous access of every request, spills these pairs in runs sorted by access_number,
+ * and merges those into a stream of operations written to the op file.
+ * Every file is read and written sequentially and the spilled files are removed once
+ * the builder is destroyed.
+ */
+class ExternalOpBuilder {
+ private:
+  using request = IncrementAndFreeze::request;
+
+  // A request that has a previous access
+  struct AccessPair {
+    req_count_t access_number;
+    req_count_t last_access;
+  };
+
+  IafConfig config;
+  std::string scratch_dir;
+  size_t memory_budget;
+
+  req_count_t access_number = 0;
+  std::vector<request> run_buffer;
+  size_t run_capacity;
+  std::vector<std::unique_ptr<SpillFile>> request_runs;
+  uint64_t bytes_spilled = 0;
+
+  // Sort the run_buffer and spill it to a new run file
+  void spill_requests();
+
+  // Merge the request runs and spill the AccessPairs in runs sorted by access_number.
+  // Returns the number of unique ids.
+  req_count_t find_last_accesses(std::vector<std::unique_ptr<SpillFile>>& pair_runs);
+
+  // Merge the pair runs and write the operations of every request to fd
+  template <typename OpT>
+  uint64_t write_operations(std::vector<std::unique_ptr<SpillFile>>& pair_runs, int fd);
+ public:
+  // memory_budget: approximate number of bytes of memory used for buffering
+  ExternalOpBuilder(const std::string& scratch_dir, size_t memory_budget,
+                    IafConfig config = tuned_config());
+  ~ExternalOpBuilder();
+
+  // Logs a memory access. The order this function is called in matters. Exits if more than
+  // Op::max_requests accesses are logged between builds, which may only be reached if
+  // ADDR_BIT32 makes Ops 32 bits wide.
+  void memory_access(req_count_t addr);
+
+  /*
+   * Write the operations of every request logged so far to the op file at op_path.
+   * The logged requests are consumed, so the builder is empty afterwards.
+   * Returns the header of the op file. Exits if a file cannot be written.
+   */
+  OpFileHeader build(const std::string& op_path);
+
+  // Number of requests logged since the last build()
+  req_count_t num_requests() const { return access_number; }
+
+  // Total bytes written to spilled files, for measuring the I/O volume of a build
+  uint64_t get_bytes_spilled() const { return bytes_spilled; }
+};
+
+#endif  // ONLINE_CACHE_SIMULATOR_EXTERNAL_OPS_H_
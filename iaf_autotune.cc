@@ -0,0 +1,172 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Finds the IncrementAndFreeze parameters that are fastest upon this machine for each
+// number of threads and writes them to a tuning profile.
+
+#include <omp.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "increment_and_freeze.h"
+#include "params.h"
+#include "tuning_profile.h"
+#include "workload.h"
+
+// Calibration traces are shorter than the simulation workloads so the search stays quick
+constexpr uint64_t kCalibrationAccesses = 1 << 22;
+constexpr uint64_t kCalibrationUniverse = kIdUniverseSize;
+constexpr size_t kCalibrationReps       = 2;   // each config is timed this many times
+constexpr size_t kDescentRounds         = 2;   // passes over the parameters
+
+// Total time to compute the success function of every trace with config. Each trace is
+// timed kCalibrationReps times and the fastest is kept.
+double time_config(IafConfig config, const std::vector<std::vector<uint64_t>>& traces) {
+  double total = 0;
+  for (auto& trace : traces) {
+    double best = INFINITY;
+    for (size_t rep = 0; rep < kCalibrationReps; rep++) {
+      IncrementAndFreeze iaf(config);
+      for (auto addr : trace)
+        iaf.memory_access(addr);
+      auto start = absl::Now();
+      iaf.get_success_function();
+      best = std::min(best, absl::ToDoubleSeconds(absl::Now() - start));
+    }
+    total += best;
+  }
+  return total;
+}
+
+// A parameter of IafConfig and the values to try for it
+struct Dimension {
+  std::string name;
+  std::vector<IafConfig> (*candidates)(IafConfig base);
+};
+
+std::vector<IafConfig> branching_candidates(IafConfig base) {
+  std::vector<IafConfig> ret;
+  for (size_t branching : kIafBranchings) {
+    base.branching = branching;
+    ret.push_back(base);
+  }
+  return ret;
+}
+
+std::vector<IafConfig> base_case_candidates(IafConfig base) {
+  std::vector<IafConfig> ret;
+  for (auto [solver, size] : {std::pair{BRUTE_FORCE, 128}, std::pair{BRUTE_FORCE, 256},
+                              std::pair{BRUTE_FORCE, 512}, std::pair{FENWICK_TREE, 1024},
+                              std::pair{FENWICK_TREE, 4096}, std::pair{FENWICK_TREE, 16384}}) {
+    base.base_case_solver = solver;
+    base.base_case_size = size;
+    ret.push_back(base);
+  }
+  return ret;
+}
+
+std::vector<IafConfig> scheduler_candidates(IafConfig base) {
+  std::vector<IafConfig> ret;
+  for (Scheduler scheduler : {OPENMP_TASKS, WORK_STEALING}) {
+    base.scheduler = scheduler;
+    ret.push_back(base);
+  }
+  return ret;
+}
+
+std::vector<IafConfig> task_cutoff_candidates(IafConfig base) {
+  std::vector<IafConfig> ret;
+  for (size_t cutoff : {0, 8192, 65536, 524288}) {
+    base.task_cutoff = cutoff;
+    ret.push_back(base);
+  }
+  return ret;
+}
+
+// Coordinate descent: optimize each parameter in turn while holding the others fixed
+IafConfig tune(size_t threads, const std::vector<std::vector<uint64_t>>& traces) {
+  std::vector<Dimension> dims = {{"branching", branching_candidates},
+                                 {"base case", base_case_candidates}};
+  if (threads > 1) {
+    dims.push_back({"scheduler", scheduler_candidates});
+    dims.push_back({"task cutoff", task_cutoff_candidates});
+  }
+
+  IafConfig best;
+  double best_time = time_config(best, traces);
+  std::cout << "  default" << std::setw(24) << best_time << "s" << std::endl;
+  for (size_t round = 0; round < kDescentRounds; round++) {
+    for (auto& dim : dims) {
+      for (IafConfig config : dim.candidates(best)) {
+        double t = time_config(config, traces);
+        if (t < best_time) {
+          best_time = t;
+          best = config;
+        }
+      }
+      std::cout << "  " << std::left << std::setw(12) << dim.name << std::right
+                << std::setw(19) << best_time << "s" << std::endl;
+    }
+  }
+  return best;
+}
+
+constexpr char ArgumentsString[] = "Arguments: profile_file\n\
+profile_file: Where to write the tuning profile. Load it by setting IAF_TUNING_PROFILE.";
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    std::cerr << "ERROR: Incorrect number of arguments!" << std::endl;
+    std::cerr << ArgumentsString << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::string profile_file = argv[1];
+
+  std::vector<std::vector<uint64_t>> traces = {
+      generate_zipf(kSeed, 0, kCalibrationAccesses, kCalibrationUniverse),
+      generate_zipf(kSeed, 0.6, kCalibrationAccesses, kCalibrationUniverse)};
+
+  // Tune for every power of 2 number of threads and the maximum
+  const size_t max_threads = omp_get_max_threads();
+  std::vector<size_t> thread_counts;
+  for (size_t threads = 1; threads < max_threads; threads *= 2)
+    thread_counts.push_back(threads);
+  thread_counts.push_back(max_threads);
+
+  std::vector<TuningEntry> entries;
+  for (size_t threads : thread_counts) {
+    std::cout << "Threads = " << threads << std::endl;
+    omp_set_num_threads(threads);
+    entries.push_back({threads, tune(threads, traces)});
+  }
+
+  if (!write_tuning_profile(profile_file, entries)) {
+    std::cerr << "ERROR: Could not write tuning profile: " << profile_file << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::cout << "Wrote tuning profile " << profile_file << std::endl;
+}
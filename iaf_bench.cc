@@ -0,0 +1,220 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Micro-benchmarks of the individual phases of IncrementAndFreeze
+
+#include <omp.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "base_case.h"
+#include "bounded_iaf.h"
+#include "increment_and_freeze.h"
+#include "params.h"
+#include "workload.h"
+
+using request = IncrementAndFreeze::request;
+
+// The requests of kAccesses accesses upon kIdUniverseSize ids. If alpha is 0 then every id is
+// accessed equally often, otherwise the accesses are zipfian with parameter alpha.
+std::vector<request> generate_requests(uint64_t seed, double alpha) {
+  std::vector<uint64_t> ids = generate_zipf(seed, alpha);
+  std::vector<request> reqs;
+  reqs.reserve(ids.size());
+  for (uint64_t i = 0; i < ids.size(); i++)
+    reqs.emplace_back(ids[i], i + 1);
+  return reqs;
+}
+
+// Time sorting the requests with each SortEngine
+void sort_bench(const std::vector<request>& reqs) {
+  for (auto [engine, name] : {std::pair{STD_SORT, "std::sort"}, std::pair{RADIX_SORT, "radix"}}) {
+    std::vector<request> copy = reqs;
+    auto start = absl::Now();
+    IncrementAndFreeze::sort_requests(copy, engine);
+    auto duration = absl::Now() - start;
+    std::cout << std::setw(16) << name << std::setw(16) << duration << std::endl;
+  }
+}
+
+// Time computing the success function with each OpBuilder
+void ops_bench(const std::vector<request>& reqs) {
+  for (auto [builder, name] : {std::pair{SORT_REQUESTS, "sort"},
+                               std::pair{LAST_ACCESS_INDEX, "last access"}}) {
+    IafConfig config;
+    config.op_builder = builder;
+    IncrementAndFreeze iaf(config);
+    for (auto& req : reqs)
+      iaf.memory_access(req.addr);
+
+    auto start = absl::Now();
+    iaf.get_success_function();
+    auto duration = absl::Now() - start;
+    std::cout << std::setw(16) << name << std::setw(16) << duration << std::endl;
+  }
+}
+
+// Build the operations of requests [begin, begin + len) as though they were a base case
+std::vector<Op> base_case_ops(const std::vector<request>& reqs, size_t begin, size_t len) {
+  std::vector<Op> ops{Op()};
+  std::unordered_map<req_count_t, req_count_t> last;
+  for (req_count_t access_num = 1; access_num <= len; access_num++) {
+    req_count_t addr = reqs[begin + access_num - 1].addr % len; // force reuse within the leaf
+    req_count_t prev = last[addr];
+    if (access_num > 1) ops.emplace_back(access_num - 1, prev ? -1 : 0);
+    if (prev != 0) ops.emplace_back(prev);
+    last[addr] = access_num;
+  }
+  return ops;
+}
+
+// Time the base case kernel of each SimdLevel upon many kIafBaseCase sized leaves
+void simd_bench(const std::vector<request>& reqs) {
+  constexpr size_t num_leaves = 1024;
+  std::vector<std::vector<Op>> leaves;
+  for (size_t i = 0; i < num_leaves; i++)
+    leaves.push_back(base_case_ops(reqs, i * kIafBaseCase, kIafBaseCase));
+  std::vector<int64_t> depths(3 * kIafBaseCase);
+
+  for (auto [level, name] : {std::pair{SIMD_SCALAR, "scalar"}, std::pair{SIMD_SSE42, "sse4.2"},
+                             std::pair{SIMD_AVX2, "avx2"}, std::pair{SIMD_AVX512, "avx512"}}) {
+    if (level > detect_simd_level()) continue;
+    for (bool narrow : {false, true}) {
+      BaseCaseKernel<> kernel = base_case_kernel(level, narrow);
+      size_t checksum = 0;
+      auto start = absl::Now();
+      for (size_t rep = 0; rep < 100; rep++) {
+        for (auto& ops : leaves) {
+          size_t num_depths = kernel(ops.data(), ops.size(), 1, kIafBaseCase, depths.data());
+          checksum += depths[num_depths - 1];
+        }
+      }
+      auto duration = absl::Now() - start;
+      std::cout << std::setw(16) << name << std::setw(8) << (narrow ? "16bit" : "32bit")
+                << std::setw(16) << duration << "  (checksum " << checksum << ")" << std::endl;
+    }
+  }
+}
+
+// Time both base case solvers upon leaves of increasing size to find where the
+// Fenwick tree overtakes brute force. Then time whole runs with each solver.
+void leaf_bench(const std::vector<request>& reqs) {
+  constexpr size_t total_reqs = 1 << 20;
+  BaseCaseKernel<> brute = base_case_kernel(detect_simd_level(), true);
+  std::cout << std::setw(16) << "leaf size" << std::setw(16) << "brute ns/req"
+            << std::setw(16) << "fenwick ns/req" << std::endl;
+  for (size_t len = 16; len <= 65536; len *= 2) {
+    std::vector<std::vector<Op>> leaves;
+    for (size_t i = 0; i < total_reqs / len; i++)
+      leaves.push_back(base_case_ops(reqs, i * len, len));
+    std::vector<int64_t> depths(2 * len + 1);
+
+    auto time_kernel = [&](BaseCaseKernel<> kernel) {
+      auto start = absl::Now();
+      for (auto& ops : leaves)
+        kernel(ops.data(), ops.size(), 1, len, depths.data());
+      return absl::ToDoubleNanoseconds(absl::Now() - start) / total_reqs;
+    };
+    std::cout << std::setw(16) << len << std::setw(16);
+    if (len <= kMaxBruteBaseCase) std::cout << time_kernel(brute);
+    else std::cout << "-";
+    std::cout << std::setw(16) << time_kernel(fenwick_base_case) << std::endl;
+  }
+
+  for (auto [solver, size] : {std::pair{BRUTE_FORCE, (int)kIafBaseCase}, std::pair{BRUTE_FORCE, 1024},
+                              std::pair{FENWICK_TREE, 1024}, std::pair{FENWICK_TREE, 4096},
+                              std::pair{FENWICK_TREE, 16384}, std::pair{FENWICK_TREE, 65536}}) {
+    IafConfig config;
+    config.base_case_solver = solver;
+    config.base_case_size = size;
+    IncrementAndFreeze iaf(config);
+    for (auto& req : reqs)
+      iaf.memory_access(req.addr);
+
+    auto start = absl::Now();
+    iaf.get_success_function();
+    auto duration = absl::Now() - start;
+    std::cout << std::setw(16) << (solver == BRUTE_FORCE ? "brute " : "fenwick ") + std::to_string(size)
+              << std::setw(16) << duration << std::endl;
+  }
+}
+
+// Time BoundedIAF with small chunks, and IncrementAndFreeze, under each Scheduler
+void sched_bench(const std::vector<request>& reqs) {
+  for (auto [scheduler, name] : {std::pair{OPENMP_TASKS, "openmp"},
+                                 std::pair{WORK_STEALING, "work stealing"}}) {
+    IafConfig config;
+    config.scheduler = scheduler;
+    BoundedIAF bounded(4096, BoundedIAF::unlimited_cache, config);
+    auto start = absl::Now();
+    for (auto& req : reqs)
+      bounded.memory_access(req.addr);
+    bounded.get_success_function();
+    auto bounded_duration = absl::Now() - start;
+
+    IncrementAndFreeze iaf(config);
+    for (auto& req : reqs)
+      iaf.memory_access(req.addr);
+    start = absl::Now();
+    iaf.get_success_function();
+    auto iaf_duration = absl::Now() - start;
+    std::cout << std::setw(16) << name << std::setw(16) << bounded_duration
+              << std::setw(16) << iaf_duration << std::endl;
+  }
+}
+
+constexpr char ArgumentsString[] = "Arguments: benchmark\n\
+benchmark: Which phase to benchmark. One of: 'sort', 'ops', 'simd', 'leaf', 'sched'";
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    std::cerr << "ERROR: Incorrect number of arguments!" << std::endl;
+    std::cerr << ArgumentsString << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::string bench_arg = argv[1];
+
+  std::cout << "Accesses = " << kAccesses << std::endl;
+  std::cout << "Universe = " << kIdUniverseSize << std::endl;
+  std::cout << "Threads  = " << omp_get_max_threads() << std::endl;
+
+  for (double alpha : {0.0, 0.6}) {
+    std::cout << (alpha == 0 ? "Uniform" : "Zipfian: " + std::to_string(alpha)) << std::endl;
+    std::vector<request> reqs = generate_requests(kSeed, alpha);
+
+    if (bench_arg == "sort")     sort_bench(reqs);
+    else if (bench_arg == "ops") ops_bench(reqs);
+    else if (bench_arg == "simd") simd_bench(reqs);
+    else if (bench_arg == "leaf") leaf_bench(reqs);
+    else if (bench_arg == "sched") sched_bench(reqs);
+    else {
+      std::cerr << "ERROR: Did not recognize benchmark: " << bench_arg << std::endl;
+      std::cerr << ArgumentsString << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+}
@@ -0,0 +1,372 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <gtest/gtest.h>
+#include <omp.h>
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "base_case.h"
+#include "bounded_iaf.h"
+#include "container_cache_sim.h"
+#include "external_ops.h"
+#include "increment_and_freeze.h"
+#include "partition.h"
+#include "prefix_sum.h"
+#include "radix_sort.h"
+#include "test_traces.h"
+#include "tuning_profile.h"
+
+namespace {
+using SuccessVector = CacheSim::SuccessVector;
+using request = IncrementAndFreeze::request;
+
+// Assert that IncrementAndFreeze and BoundedIAF under config agree with ContainerCacheSim
+void validate_config(IafConfig config, const std::vector<req_count_t>& trace) {
+  ContainerCacheSim truth_sim;
+  SuccessVector truth = run_trace(truth_sim, trace);
+
+  IncrementAndFreeze iaf(config);
+  SuccessVector iaf_succ = run_trace(iaf, trace);
+  ASSERT_EQ(iaf_succ.size(), truth.size());
+  for (size_t i = 1; i < truth.size(); i++)
+    ASSERT_EQ(iaf_succ[i], truth[i]) << "IAF differs at " << i;
+
+  BoundedIAF bounded(512, BoundedIAF::unlimited_cache, config);
+  SuccessVector bounded_succ = run_trace(bounded, trace);
+  for (size_t i = 1; i < std::min(bounded_succ.size(), truth.size()); i++)
+    ASSERT_EQ(bounded_succ[i], truth[i]) << "BoundedIAF differs at " << i;
+}
+}  // namespace
+
+TEST(IafConfigTests, RadixSortMatchesStdSort) {
+  std::mt19937_64 gen(7);
+  for (req_count_t universe : {(req_count_t)16, (req_count_t)100'000, (req_count_t)-1 >> 1}) {
+    std::vector<request> reqs;
+    for (size_t i = 0; i < 200'000; i++)
+      reqs.emplace_back(gen() % universe, i + 1);
+    if (universe == 16) std::shuffle(reqs.begin(), reqs.end(), gen); // not in access order
+
+    std::vector<request> expect = reqs;
+    IncrementAndFreeze::sort_requests(expect, STD_SORT);
+    IncrementAndFreeze::sort_requests(reqs, RADIX_SORT);
+    ASSERT_EQ(reqs.size(), expect.size());
+    for (size_t i = 0; i < reqs.size(); i++) {
+      ASSERT_EQ(reqs[i].addr, expect[i].addr);
+      ASSERT_EQ(reqs[i].access_number, expect[i].access_number);
+    }
+  }
+
+  // a digit shared by every element, counted by many threads, skips its pass
+  std::vector<uint64_t> keys(4 * kRadixSerialCutoff, 5);
+  std::vector<uint64_t> scratch(keys.size());
+  const int threads = omp_get_max_threads();
+  omp_set_num_threads(4);
+  bool moved = radix_pass(keys.data(), scratch.data(), keys.size(),
+                          [](uint64_t key) { return key & kRadixMask; });
+  omp_set_num_threads(threads);
+  ASSERT_FALSE(moved);
+}
+
+TEST(IafConfigTests, SortEngines) {
+  auto trace = skewed_trace(50'000, 2'000, 42);
+  for (SortEngine engine : {STD_SORT, RADIX_SORT}) {
+    IafConfig config;
+    config.sort_engine = engine;
+    config.op_builder = SORT_REQUESTS;
+    validate_config(config, trace);
+  }
+}
+
+TEST(IafConfigTests, OpBuilders) {
+  // a dense universe of ids and a sparse one
+  for (req_count_t universe : {(req_count_t)2'000, (req_count_t)-1 >> 2}) {
+    auto trace = skewed_trace(50'000, universe, 42);
+    for (OpBuilder builder : {SORT_REQUESTS, LAST_ACCESS_INDEX}) {
+      IafConfig config;
+      config.op_builder = builder;
+      validate_config(config, trace);
+    }
+  }
+}
+
+TEST(IafConfigTests, SimdLevels) {
+  auto trace = skewed_trace(50'000, 2'000, 42);
+  for (SimdLevel level : {SIMD_SCALAR, SIMD_SSE42, SIMD_AVX2, SIMD_AVX512}) {
+    IafConfig config;
+    config.max_simd = level;
+    validate_config(config, trace);
+  }
+}
+
+TEST(IafConfigTests, BaseCaseSolvers) {
+  auto trace = skewed_trace(50'000, 2'000, 42);
+  for (auto [solver, size] : {std::pair{BRUTE_FORCE, 64}, std::pair{BRUTE_FORCE, 2048},
+                              std::pair{FENWICK_TREE, 256}, std::pair{FENWICK_TREE, 4096},
+                              std::pair{FENWICK_TREE, 65536}}) {
+    IafConfig config;
+    config.base_case_solver = solver;
+    config.base_case_size = size;
+    validate_config(config, trace);
+  }
+}
+
+TEST(IafConfigTests, BaseCaseKernelsAgree) {
+  // Build the operations of a trace short enough to be a single base case
+  std::mt19937_64 gen(3);
+  std::vector<Op> ops{Op()};
+  std::vector<req_count_t> last(16, 0);
+  const req_count_t num_reqs = 4 * kIafBaseCase;
+  for (req_count_t access_num = 1; access_num <= num_reqs; access_num++) {
+    req_count_t addr = gen() % last.size();
+    if (access_num > 1) ops.emplace_back(access_num - 1, last[addr] ? -1 : 0);
+    if (last[addr] != 0) ops.emplace_back(last[addr]);
+    last[addr] = access_num;
+  }
+
+  std::vector<int64_t> expect(ops.size());
+  size_t num_expect = base_case_kernel(SIMD_SCALAR, false)(ops.data(), ops.size(), 1, num_reqs,
+                                                           expect.data());
+  ASSERT_GT(num_expect, 0);
+
+  std::vector<int64_t> fenwick_depths(ops.size());
+  ASSERT_EQ(fenwick_base_case(ops.data(), ops.size(), 1, num_reqs, fenwick_depths.data()),
+            num_expect);
+  for (size_t i = 0; i < num_expect; i++)
+    ASSERT_EQ(fenwick_depths[i], expect[i]) << "fenwick";
+  for (SimdLevel level : {SIMD_SCALAR, SIMD_SSE42, SIMD_AVX2, SIMD_AVX512}) {
+    if (level > detect_simd_level()) continue;
+    for (bool narrow : {true, false}) {
+      std::vector<int64_t> depths(ops.size());
+      size_t num_depths = base_case_kernel(level, narrow)(ops.data(), ops.size(), 1, num_reqs,
+                                                          depths.data());
+      ASSERT_EQ(num_depths, num_expect);
+      for (size_t i = 0; i < num_depths; i++)
+        ASSERT_EQ(depths[i], expect[i]) << "level " << level << " narrow " << narrow;
+    }
+  }
+}
+
+TEST(IafConfigTests, DeepStackDepths) {
+  // Stack depths beyond kIafLocalHits bypass the per-thread histograms
+  auto trace = skewed_trace(4 * kIafLocalHits, 2 * kIafLocalHits, 42);
+  validate_config(IafConfig(), trace);
+}
+
+TEST(IafConfigTests, ParallelPrefixSum) {
+  std::mt19937_64 gen(5);
+  for (size_t n : {(size_t)0, (size_t)1000, 4 * kPrefixSumSerialCutoff + 3}) {
+    std::vector<req_count_t> in(n);
+    for (auto& val : in) val = gen() % 100;
+    std::vector<req_count_t> expect(n);
+    req_count_t running = 0;
+    for (size_t i = 0; i < n; i++)
+      expect[i] = running += in[i];
+
+    std::vector<req_count_t> out(n);
+    parallel_prefix_sum(in.data(), out.data(), n);
+    ASSERT_EQ(out, expect);
+    parallel_prefix_sum(in.data(), in.data(), n); // in place
+    ASSERT_EQ(in, expect);
+  }
+}
+
+TEST(IafConfigTests, Schedulers) {
+  auto trace = skewed_trace(50'000, 2'000, 42);
+  for (Scheduler scheduler : {OPENMP_TASKS, WORK_STEALING}) {
+    for (size_t cutoff : {(size_t)0, (size_t)1, (size_t)-1}) {
+      IafConfig config;
+      config.scheduler = scheduler;
+      config.task_cutoff = cutoff;
+      validate_config(config, trace);
+    }
+  }
+}
+
+TEST(IafConfigTests, Branchings) {
+  auto trace = skewed_trace(50'000, 2'000, 42);
+  for (size_t branching : kIafBranchings) {
+    for (auto [solver, size] : {std::pair{BRUTE_FORCE, 128}, std::pair{FENWICK_TREE, 4096}}) {
+      IafConfig config;
+      config.branching = branching;
+      config.base_case_solver = solver;
+      config.base_case_size = size;
+      validate_config(config, trace);
+    }
+  }
+}
+
+TEST(IafConfigTests, OpEncodings) {
+  static_assert(sizeof(CompactOp) == 8);
+  for (req_count_t universe : {(req_count_t)2'000, (req_count_t)-1 >> 2}) {
+    auto trace = skewed_trace(50'000, universe, 42);
+    for (OpEncoding encoding : {WIDE_OPS, COMPACT_OPS}) {
+      for (size_t branching : {(size_t)4, (size_t)64}) {
+        IafConfig config;
+        config.op_encoding = encoding;
+        config.branching = branching;
+        validate_config(config, trace);
+      }
+    }
+  }
+}
+
+TEST(IafConfigTests, PartitionMapping) {
+  std::mt19937_64 gen(9);
+  for (size_t trial = 0; trial < 1000; trial++) {
+    req_count_t start = gen() % 1'000'000 + 1;
+    req_count_t end = start + 1 + gen() % (trial % 2 ? 1'000 : 100'000'000);
+    PartitionState<256, CompactOp> state(start, end, 1, gen() % 512 + 1);
+    ASSERT_GE(state.num_partitions(), 2);
+    ASSERT_EQ(state.partition_start(0), start);
+    ASSERT_EQ(state.partition_start(state.num_partitions()), end + 1);
+    for (size_t idx = 0; idx < state.num_partitions(); idx++) {
+      req_count_t first = state.partition_start(idx);
+      req_count_t last = state.partition_start(idx + 1) - 1;
+      ASSERT_LE(first, last);
+      ASSERT_EQ(state.partition_of(first), idx);
+      ASSERT_EQ(state.partition_of(last), idx);
+      ASSERT_EQ(state.partition_of(first + gen() % (last - first + 1)), idx);
+    }
+  }
+}
+
+// Assert that the op file at path holds the operations of trace in the encoding OpT
+template <typename OpT>
+void validate_op_file(const std::string& path, const std::vector<req_count_t>& trace) {
+  std::vector<OpT> expect;
+  std::unordered_map<req_count_t, req_count_t> last;
+  for (req_count_t access_num = 1; access_num <= trace.size(); access_num++) {
+    req_count_t prev = last[trace[access_num - 1]];
+    expect.emplace_back(access_num - 1, prev ? -1 : 0);
+    if (prev != 0) expect.emplace_back(prev);
+    last[trace[access_num - 1]] = access_num;
+  }
+
+  std::ifstream in(path, std::ios::binary);
+  in.seekg(kOpFileDataOffset);
+  std::vector<OpT> ops(expect.size());
+  in.read((char*) ops.data(), ops.size() * sizeof(OpT));
+  ASSERT_TRUE(in.good());
+  ASSERT_EQ(in.peek(), EOF);
+  for (size_t i = 0; i < ops.size(); i++) {
+    ASSERT_EQ(ops[i].get_type(), expect[i].get_type()) << "op " << i;
+    ASSERT_EQ(ops[i].get_target(), expect[i].get_target()) << "op " << i;
+    ASSERT_EQ(ops[i].get_full_amnt(), expect[i].get_full_amnt()) << "op " << i;
+  }
+}
+
+TEST(IafConfigTests, ExternalOpBuilder) {
+  std::string path = testing::TempDir() + "/iaf_external.ops";
+  for (req_count_t universe : {(req_count_t)2'000, (req_count_t)-1 >> 2}) {
+    auto trace = skewed_trace(50'000, universe, 42);
+    for (OpEncoding encoding : {WIDE_OPS, COMPACT_OPS}) {
+      IafConfig config;
+      config.op_encoding = encoding;
+      // the smallest budget spills many runs
+      ExternalOpBuilder builder(testing::TempDir(), 0, config);
+      for (auto addr : trace)
+        builder.memory_access(addr);
+      OpFileHeader header = builder.build(path);
+      ASSERT_GT(builder.get_bytes_spilled(), 0);
+      ASSERT_EQ(builder.num_requests(), 0);
+
+      OpFileHeader read;
+      ASSERT_TRUE(read_op_file_header(path, read));
+      ASSERT_EQ(read.num_requests, trace.size());
+      ASSERT_EQ(read.num_ops, header.num_ops);
+      ASSERT_EQ(read.unique_ids, std::unordered_set<req_count_t>(trace.begin(), trace.end()).size());
+      if (encoding == COMPACT_OPS && sizeof(CompactOp) != sizeof(Op)) {
+        ASSERT_EQ(read.compact_ops, 1);
+        validate_op_file<CompactOp>(path, trace);
+      }
+      else
+        validate_op_file<Op>(path, trace);
+    }
+  }
+}
+
+TEST(IafConfigTests, MappedOpFile) {
+  auto trace = skewed_trace(100'000, 20'000, 42);
+  ContainerCacheSim truth_sim;
+  SuccessVector truth = run_trace(truth_sim, trace);
+
+  std::string path = testing::TempDir() + "/iaf_mapped.ops";
+  for (OpEncoding encoding : {WIDE_OPS, COMPACT_OPS}) {
+    IafConfig config;
+    config.op_encoding = encoding;
+    // Recurse within the mapping down to the base cases, page in the lower levels of the
+    // recursion, and page in everything.
+    for (size_t budget : {(size_t)0, (size_t)1 << 16, (size_t)1 << 30}) {
+      ExternalOpBuilder builder(testing::TempDir(), 0, config);
+      for (auto addr : trace)
+        builder.memory_access(addr);
+      builder.build(path);
+
+      ExternalIoStats stats;
+      IncrementAndFreeze iaf(config);
+      SuccessVector succ = iaf.get_success_function(path, budget, &stats);
+      ASSERT_EQ(succ.size(), truth.size());
+      for (size_t i = 1; i < truth.size(); i++)
+        ASSERT_EQ(succ[i], truth[i]) << "budget " << budget << " differs at " << i;
+
+      ASSERT_EQ(stats.streamed_bytes > 0, budget < (size_t)1 << 30);
+      ASSERT_EQ(stats.paged_in_bytes > 0, budget > 0);
+    }
+  }
+}
+
+TEST(IafConfigTests, TuningProfile) {
+  std::vector<TuningEntry> entries(2);
+  entries[0].threads = 1;
+  entries[0].config.branching = 64;
+  entries[1].threads = 8;
+  entries[1].config.base_case_solver = FENWICK_TREE;
+  entries[1].config.base_case_size = 4096;
+  entries[1].config.scheduler = WORK_STEALING;
+  entries[1].config.task_cutoff = 65536;
+
+  std::string path = testing::TempDir() + "/iaf_tuning_profile";
+  ASSERT_TRUE(write_tuning_profile(path, entries));
+  std::vector<TuningEntry> loaded;
+  ASSERT_TRUE(read_tuning_profile(path, loaded));
+  ASSERT_EQ(loaded.size(), 2);
+
+  IafConfig few = select_tuning(loaded, 4);
+  ASSERT_EQ(few.branching, 64);
+  ASSERT_EQ(few.base_case_solver, BRUTE_FORCE);
+  IafConfig many = select_tuning(loaded, 16);
+  ASSERT_EQ(many.branching, kIafBranching);
+  ASSERT_EQ(many.base_case_solver, FENWICK_TREE);
+  ASSERT_EQ(many.base_case_size, 4096);
+  ASSERT_EQ(many.scheduler, WORK_STEALING);
+  ASSERT_EQ(many.task_cutoff, 65536);
+  validate_config(many, skewed_trace(20'000, 2'000, 42));
+
+  ASSERT_FALSE(read_tuning_profile(path + ".missing", loaded));
+  ASSERT_EQ(select_tuning(loaded, 4).branching, kIafBranching);
+
+  // a fanout the recursion is not built for is malformed
+  std::ofstream(path) << "threads=1 branching=12" << std::endl;
+  ASSERT_FALSE(read_tuning_profile(path, loaded));
+  ASSERT_EQ(select_tuning(loaded, 4).branching, kIafBranching);
+}
@@ -20,8 +20,78 @@
 #ifndef ONLINE_CACHE_SIMULATOR_IAF_PARAMS_H_
 #define ONLINE_CACHE_SIMULATOR_IAF_PARAMS_H_
 
+#include <cstddef>     // for size_t
+
 // IncrementAndFreeze parameters
-constexpr size_t kIafBaseCase      = 256;  // Base case size for IAF algorithm
-constexpr size_t kIafBranching     = 16;   // Fanout of each recursive node in 'tree'
+constexpr size_t kIafBaseCase      = 256;  // Default base case size for IAF algorithm
+constexpr size_t kIafBranching     = 16;   // Default fanout of each recursive node in 'tree'
+constexpr size_t kIafBranchings[]  = {4, 8, 16, 32, 64, 128, 256}; // Fanouts the recursion is built for
+constexpr size_t kNumIafBranchings = sizeof(kIafBranchings) / sizeof(kIafBranchings[0]);
+constexpr size_t kIafSmallNodeSplit = 4;  // Small nodes split into parts of base case size / this
+constexpr size_t kIafLocalHits     = 1 << 16; // Stack depths counted in per-thread histograms
+constexpr size_t kIafTasksPerWorker = 64;   // Adaptive task cutoff aims for this many tasks
+
+// Returns if the recursion is built for a fanout of branching
+constexpr bool is_iaf_branching(size_t branching) {
+  for (size_t fanout : kIafBranchings)
+    if (fanout == branching) return true;
+  return false;
+}
+
+// Algorithm used to sort the requests by (addr, access_number)
+enum SortEngine {
+  STD_SORT,   // std::sort (parallel if compiled with _GLIBCXX_PARALLEL)
+  RADIX_SORT, // parallel LSD radix sort upon packed request keys
+};
+
+// How the Prefix and Postfix operations are built from the requests
+enum OpBuilder {
+  SORT_REQUESTS,     // sort requests by (addr, access_number) to find each previous access
+  LAST_ACCESS_INDEX, // scan requests in access order against an index of last accesses
+};
+
+// Instruction sets for which there is a base case kernel (in increasing order)
+enum SimdLevel {
+  SIMD_SCALAR,
+  SIMD_SSE42,
+  SIMD_AVX2,
+  SIMD_AVX512,
+};
+
+// How projected sequences of at most base_case_size requests are solved
+enum BaseCaseSolver {
+  BRUTE_FORCE,  // O(k*n) vectorized range increments, best for small base cases
+  FENWICK_TREE, // O(k log n) Fenwick tree, permits base cases of many thousands of requests
+};
+
+// How the tasks of the recursion are run in parallel
+enum Scheduler {
+  OPENMP_TASKS,  // OpenMP tasks within a parallel region opened for each chunk
+  WORK_STEALING, // a work stealing thread pool that lives as long as the simulator
+};
+
+// How the Prefix and Postfix operations are stored
+enum OpEncoding {
+  WIDE_OPS,    // Op: a request count sized target and full amount
+  COMPACT_OPS, // CompactOp: a single 64 bit word when there are less than 2^31 requests
+};
+
+// IncrementAndFreeze options that may be chosen at runtime
+struct IafConfig {
+  SortEngine sort_engine = RADIX_SORT;
+  OpBuilder op_builder   = LAST_ACCESS_INDEX;
+  OpEncoding op_encoding = COMPACT_OPS;
+  SimdLevel max_simd     = SIMD_AVX512; // base case uses min(max_simd, detect_simd_level())
+  BaseCaseSolver base_case_solver = BRUTE_FORCE;
+  size_t base_case_size  = kIafBaseCase;  // BRUTE_FORCE is limited to kMaxBruteBaseCase
+  size_t branching       = kIafBranching; // Must be one of kIafBranchings
+  Scheduler scheduler    = OPENMP_TASKS;
+  size_t task_cutoff     = 0; // Projections of at most this many requests are not spawned as
+                              // tasks. If 0 then n / (kIafTasksPerWorker * workers) is used.
+  size_t segment_size    = 0; // IncrementAndFreeze numbers at most this many requests at once,
+                              // carrying the living requests of each segment into the next.
+                              // If 0, or more than its ops permit, then the most they permit.
+                              // Segments grow while the living requests fill half of one.
+};
 
 #endif  // ONLINE_CACHE_SIMULATOR_IAF_PARAMS_H_
@@ -0,0 +1,266 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+// Computes the success function of a trace file with any of the CacheSims
+
+#include <omp.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "absl/time/clock.h"
+#include "csv_trace.h"
+#include "sim_factory.h"
+#include "trace_format.h"
+#include "uring_reader.h"
+
+constexpr char ArgumentsString[] = "Arguments: [flags] trace_file\n\
+trace_file:      A text trace with one address per line, a binary trace, or a CSV trace.\n\
+--input=I        Kind of trace. One of: 'auto', 'kv_csv', 'block_csv'. Default = auto, which\n\
+                 reads binary traces and text traces of one address per line.\n\
+                 'kv_csv' reads rows of (timestamp, key, size, op) and accesses each key.\n\
+                 'block_csv' reads rows of (timestamp, disk, offset, length, type) and accesses\n\
+                 every block of each extent.\n\
+--csv_header=B   If the first line of a CSV trace names its columns. Default = 0.\n\
+--key_column=N   Column of the key of 'kv_csv' rows, from 0. Default = 1.\n\
+--block_size=N   Bytes of each block of 'block_csv' traces. Default = 4096.\n\
+--sim=S          Which simulator to use. One of: 'OS_TREE', 'OS_SET', 'IAF', 'BOUND_IAF'.\n\
+                 Default = BOUND_IAF, whose memory does not grow with the trace length.\n\
+--threads=N      Number of threads. Default = all.\n\
+--cache_limit=N  Largest cache size of the success function. BOUND_IAF only. Default = none.\n\
+--chunk=N        Minimum chunk size of BOUND_IAF. Default = 65536.\n\
+--remap=R        If IAF and BOUND_IAF rename the addresses of a text or binary trace to dense\n\
+                 ids. One of: 'auto', 'on', 'off'. Default = auto, which renames those of\n\
+                 binary traces with addresses wider than 32 bits.\n\
+--reader=R       How to read the trace. One of: 'mmap', 'uring'. Default = mmap.\n\
+                 'uring' reads with io_uring and O_DIRECT, overlapping reads with simulation.\n\
+--queue_depth=N  Reads in flight of the uring reader. Default = 8.\n\
+--read_block=N   Bytes of each read of the uring reader. Default = 1048576.\n\
+--format=F       Format of the success function. One of: 'table', 'csv'. Default = table.\n\
+--out=FILE       Where to write the success function. Default = stdout.";
+
+[[noreturn]] void usage_error(const std::string& message) {
+  std::cerr << "ERROR: " << message << std::endl;
+  std::cerr << ArgumentsString << std::endl;
+  exit(EXIT_FAILURE);
+}
+
+// Parse the value of a numeric flag
+size_t parse_count(const std::string& flag, const std::string& value) {
+  size_t used = 0;
+  size_t count = 0;
+  try {
+    count = std::stoull(value, &used);
+  } catch (const std::exception&) {}
+  if (used == 0 || used != value.size())
+    usage_error("Flag " + flag + " expects a number, got: " + value);
+  return count;
+}
+
+// Number of bits of the ids sim accepts
+size_t id_bits(const CacheSim& sim) { return 64 - __builtin_clzll(sim.get_max_id()); }
+
+[[noreturn]] void trace_error(const std::string& path, uint64_t line, const CacheSim& sim) {
+  if (line != 0)
+    std::cerr << "ERROR: " << path << ":" << line << " is not an address of at most "
+              << id_bits(sim) << " bits" << std::endl;
+  else std::cerr << "ERROR: " << path << " is not a well formed binary trace" << std::endl;
+  exit(EXIT_FAILURE);
+}
+
+// Write the success function with one line of cache size, hits and hit rate per cache size
+void dump_csv(std::ostream& os, const CacheSim::SuccessVector& succ, uint64_t num_accesses) {
+  os << "cache_size,hits,hit_rate" << std::endl;
+  for (size_t page = 1; page < succ.size(); page++)
+    os << page << "," << succ[page] << "," << (double) succ[page] / num_accesses << "\n";
+}
+
+int main(int argc, char** argv) {
+  std::string sim_arg = "BOUND_IAF";
+  std::string format_arg = "table";
+  std::string reader_arg = "mmap";
+  std::string input_arg = "auto";
+  std::string remap_arg = "auto";
+  CsvTraceConfig csv_config;
+  std::string out_arg;
+  std::string trace_path;
+  size_t threads = 0;
+  size_t cache_limit = 0;
+  size_t min_chunk = 65536;
+  size_t queue_depth = kUringQueueDepth;
+  size_t read_block = kUringBlockBytes;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.rfind("--", 0) != 0) {
+      if (!trace_path.empty()) usage_error("More than one trace file given");
+      trace_path = arg;
+      continue;
+    }
+    size_t eq = arg.find('=');
+    if (eq == std::string::npos) usage_error("Flag " + arg + " has no value");
+    std::string flag = arg.substr(0, eq);
+    std::string value = arg.substr(eq + 1);
+    if (flag == "--sim")              sim_arg = value;
+    else if (flag == "--threads")     threads = parse_count(flag, value);
+    else if (flag == "--cache_limit") cache_limit = parse_count(flag, value);
+    else if (flag == "--chunk")       min_chunk = parse_count(flag, value);
+    else if (flag == "--reader")      reader_arg = value;
+    else if (flag == "--queue_depth") queue_depth = parse_count(flag, value);
+    else if (flag == "--read_block")  read_block = parse_count(flag, value);
+    else if (flag == "--input")       input_arg = value;
+    else if (flag == "--remap")       remap_arg = value;
+    else if (flag == "--csv_header")  csv_config.header = parse_count(flag, value) != 0;
+    else if (flag == "--key_column")  csv_config.key_column = parse_count(flag, value);
+    else if (flag == "--block_size")  csv_config.block_bytes = parse_count(flag, value);
+    else if (flag == "--format")      format_arg = value;
+    else if (flag == "--out")         out_arg = value;
+    else usage_error("Did not recognize flag: " + flag);
+  }
+  if (trace_path.empty()) usage_error("No trace file given");
+  if (format_arg != "table" && format_arg != "csv")
+    usage_error("Did not recognize format: " + format_arg);
+  if (reader_arg != "mmap" && reader_arg != "uring")
+    usage_error("Did not recognize reader: " + reader_arg);
+  if (input_arg != "auto" && input_arg != "kv_csv" && input_arg != "block_csv")
+    usage_error("Did not recognize input: " + input_arg);
+  if (remap_arg != "auto" && remap_arg != "on" && remap_arg != "off")
+    usage_error("Did not recognize remap: " + remap_arg);
+  if (input_arg != "auto" && reader_arg == "uring")
+    usage_error("--reader=uring reads text and binary traces only");
+  if (csv_config.key_column >= kMaxCsvColumns || csv_config.block_bytes == 0)
+    usage_error("--key_column must be below " + std::to_string(kMaxCsvColumns)
+                + " and --block_size positive");
+  if (queue_depth == 0 || read_block == 0)
+    usage_error("--queue_depth and --read_block must be positive");
+  if (cache_limit != 0 && sim_arg != "BOUND_IAF")
+    usage_error("--cache_limit requires --sim=BOUND_IAF");
+  if (min_chunk == 0) usage_error("--chunk must be positive");
+
+  // the thread count selects the tuning profile entry, so set it before constructing the sim
+  if (threads != 0) omp_set_num_threads(threads);
+
+  // The footer of a binary trace bounds its ids, so IAF may use 32 bit ids if they fit
+  std::optional<TraceBounds> bounds;
+  if (input_arg == "auto") {
+    TraceReader footer_reader;
+    if (footer_reader.open(trace_path))
+      bounds = TraceBounds{footer_reader.get_max_addr(), footer_reader.get_num_accesses()};
+  } else if (input_arg == "block_csv") {
+    // block addresses are hashes of their disk, spread over 64 bits
+    bounds = TraceBounds{UINT64_MAX, UINT64_MAX};
+  }
+  // Renaming wide addresses to dense ids lets 32 bit ids simulate traces of 64 bit hashes
+  const bool remap = input_arg == "auto" && (sim_arg == "IAF" || sim_arg == "BOUND_IAF")
+                     && (remap_arg == "on"
+                         || (remap_arg == "auto" && bounds && bounds->max_addr > UINT32_MAX));
+  if (bounds) bounds->keys = remap;
+  const TraceBounds* known_bounds = bounds ? &*bounds : nullptr;
+
+  std::unique_ptr<CacheSim> sim;
+  if (sim_arg == "OS_TREE")        sim = new_simulator(OS_TREE);
+  else if (sim_arg == "OS_SET")    sim = new_simulator(OS_SET);
+  else if (sim_arg == "IAF")       sim = new_simulator(IAF, 0, 0, tuned_config(), known_bounds);
+  else if (sim_arg == "BOUND_IAF")
+    sim = new_simulator(BOUND_IAF, min_chunk, cache_limit, tuned_config(), known_bounds);
+  else usage_error("Did not recognize simulator: " + sim_arg);
+  if (!remap && bounds && bounds->max_addr > sim->get_max_id()) {
+    std::cerr << "ERROR: " << trace_path << " holds addresses wider than the " << id_bits(*sim)
+              << " bit ids of " << sim_arg << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::ofstream out_file;
+  if (!out_arg.empty()) {
+    out_file.open(out_arg);
+    if (!out_file.is_open()) usage_error("Could not open out file: " + out_arg);
+  }
+  std::ostream& out = out_arg.empty() ? std::cout : out_file;
+
+  auto start = absl::Now();
+  uint64_t num_accesses;
+  UringStats read_stats;
+  bool use_uring = reader_arg == "uring";
+  if (use_uring) {
+    UringTraceReader reader(queue_depth, read_block);
+    if (reader.open(trace_path)) {
+      if (!reader.replay(*sim, remap)) trace_error(trace_path, reader.get_error_line(), *sim);
+      num_accesses = reader.get_num_accesses();
+      read_stats = reader.get_stats();
+    } else {
+      std::cerr << "WARNING: Could not read the trace with io_uring, mapping it instead"
+                << std::endl;
+      use_uring = false;
+    }
+  }
+  if (input_arg != "auto") {
+    csv_config.kind = input_arg == "kv_csv" ? KV_TRACE : BLOCK_TRACE;
+    CsvTraceReader reader(csv_config);
+    if (!reader.open(trace_path)) {
+      std::cerr << "ERROR: Could not read trace: " << trace_path << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    if (!reader.replay(*sim)) {
+      std::cerr << "ERROR: " << trace_path << " has a malformed row at byte "
+                << reader.get_error_offset() << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    num_accesses = reader.get_num_accesses();
+  } else if (!use_uring && is_binary_trace(trace_path)) {
+    TraceReader reader;
+    reader.open(trace_path);
+    if (!reader.replay(*sim, remap)) trace_error(trace_path, 0, *sim);
+    num_accesses = reader.get_num_accesses();
+  } else if (!use_uring) {
+    TextTraceReader reader;
+    if (!reader.open(trace_path)) {
+      std::cerr << "ERROR: Could not read trace: " << trace_path << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    if (!reader.replay(*sim, remap)) trace_error(trace_path, reader.get_error_line(), *sim);
+    num_accesses = reader.get_num_accesses();
+  }
+  CacheSim::SuccessVector succ = sim->get_success_function();
+  auto duration = absl::Now() - start;
+  double seconds = absl::ToDoubleSeconds(duration);
+
+  std::cerr << "Accesses     = " << num_accesses << std::endl;
+  std::cerr << "Threads      = " << omp_get_max_threads() << std::endl;
+  std::cerr << "Latency      = " << duration << std::endl;
+  std::cerr << "Throughput   = " << num_accesses / seconds / 1e6 << " M accesses/s" << std::endl;
+  if (use_uring) {
+    std::cerr << "Read (MiB/s) = " << read_stats.bytes_read / seconds / (1 << 20)
+              << (read_stats.direct ? " direct" : " buffered") << ", "
+              << read_stats.reads << " reads, stalled " << read_stats.stall_seconds << "s"
+              << std::endl;
+  }
+  std::cerr << "Memory (MiB) = " << sim->get_memory_usage() << std::endl;
+
+  if (format_arg == "csv") dump_csv(out, succ, num_accesses);
+  else if (!succ.empty()) sim->dump_success_function(out, succ);
+  if (!out.flush()) {
+    std::cerr << "ERROR: Could not write the success function" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
@@ -0,0 +1,169 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "id_remapper.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+// Keys ahead of the current key whose slot is prefetched when renaming a batch
+constexpr size_t kRemapPrefetch = 16;
+
+static inline size_t slot_of(uint64_t key, size_t shift) {
+  key ^= key >> 32;
+  return (key * 0x9E3779B97F4A7C15ull) >> shift;
+}
+
+template <typename Id>
+BasicIdRemapper<Id>& BasicIdRemapper<Id>::operator=(const BasicIdRemapper& other) {
+  if (this == &other) return *this;
+  capacity = other.capacity;
+  shift = other.shift;
+  slots.reset(new Slot[capacity]);
+  for (size_t i = 0; i < capacity; i++) {
+    slots[i].key.store(other.slots[i].key.load(std::memory_order_relaxed));
+    slots[i].state.store(other.slots[i].state.load(std::memory_order_relaxed));
+  }
+  id_keys = other.id_keys;
+  next_id = other.next_id.load();
+  free_ids = other.free_ids;
+  free_taken = other.free_taken.load();
+  return *this;
+}
+
+template <typename Id>
+void BasicIdRemapper<Id>::reserve(size_t num) {
+  size_t needed = kRemapLoadFactor * (next_id + num);
+  if (needed > capacity) rebuild(needed);
+  if (id_keys.size() < next_id + num)
+    id_keys.resize(std::max(next_id + num, 2 * id_keys.size()));
+}
+
+template <typename Id>
+Id BasicIdRemapper<Id>::take_id() {
+  size_t taken = free_taken.fetch_add(1, std::memory_order_relaxed);
+  if (taken < free_ids.size()) return free_ids[taken];
+  uint64_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+  if (id >= std::numeric_limits<Id>::max()) {
+    std::cerr << "ERROR: IdRemapper ran out of ids, too many keys are living" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  return id;
+}
+
+template <typename Id>
+Id BasicIdRemapper<Id>::rename(uint64_t key) {
+  const size_t mask = capacity - 1;
+  for (size_t idx = slot_of(key, shift);; idx = (idx + 1) & mask) {
+    Slot& slot = slots[idx];
+    uint64_t state = slot.state.load(std::memory_order_acquire);
+    if (state == 0) {
+      if (slot.state.compare_exchange_strong(state, 1, std::memory_order_acquire)) {
+        slot.key.store(key, std::memory_order_relaxed);
+        Id id = take_id();
+        id_keys[id] = key;
+        slot.state.store(id + 2, std::memory_order_release);
+        return id;
+      }
+    }
+    // another thread is inserting here, its key is written once it has an id
+    while (state == 1) {
+      _mm_pause();
+      state = slot.state.load(std::memory_order_acquire);
+    }
+    if (slot.key.load(std::memory_order_relaxed) == key) return state - 2;
+  }
+}
+
+template <typename Id>
+void BasicIdRemapper<Id>::rename(const uint64_t* keys, size_t num, Id* ids) {
+  reserve(num);
+  // the table is usually larger than the cache, so prefetch the slots of upcoming keys
+  auto rename_prefetched = [&](size_t i) {
+    if (i + kRemapPrefetch < num)
+      __builtin_prefetch(&slots[slot_of(keys[i + kRemapPrefetch], shift)]);
+    ids[i] = rename(keys[i]);
+  };
+  if (num < kParallelRenameKeys) {
+    for (size_t i = 0; i < num; i++)
+      rename_prefetched(i);
+    return;
+  }
+#pragma omp parallel for
+  for (size_t i = 0; i < num; i++)
+    rename_prefetched(i);
+}
+
+template <typename Id>
+void BasicIdRemapper<Id>::insert_assigned(uint64_t key, Id id) {
+  const size_t mask = capacity - 1;
+  size_t idx = slot_of(key, shift);
+  while (slots[idx].state.load(std::memory_order_relaxed) != 0)
+    idx = (idx + 1) & mask;
+  slots[idx].key.store(key, std::memory_order_relaxed);
+  slots[idx].state.store(id + 2, std::memory_order_relaxed);
+}
+
+// Reallocate the table with capacity of at least min_capacity holding every assigned id
+template <typename Id>
+void BasicIdRemapper<Id>::rebuild(size_t min_capacity) {
+  std::unique_ptr<Slot[]> old_slots = std::move(slots);
+  size_t old_capacity = capacity;
+  capacity = 16;
+  shift = 60;
+  while (capacity < min_capacity) {
+    capacity *= 2;
+    --shift;
+  }
+  slots.reset(new Slot[capacity]);
+  for (size_t i = 0; i < capacity; i++) {
+    slots[i].key.store(0, std::memory_order_relaxed);
+    slots[i].state.store(0, std::memory_order_relaxed);
+  }
+  for (size_t i = 0; i < old_capacity; i++) {
+    uint64_t state = old_slots[i].state.load(std::memory_order_relaxed);
+    if (state >= 2) insert_assigned(old_slots[i].key.load(std::memory_order_relaxed), state - 2);
+  }
+}
+
+template <typename Id>
+void BasicIdRemapper<Id>::recycle_unmarked() {
+  // ids not yet handed out from the free list are unmarked, so if there are no more unmarked
+  // ids than those then no key was freed
+  size_t untaken = free_ids.size() - std::min(free_taken.load(), free_ids.size());
+  std::vector<Id> unmarked;
+  for (size_t id = 0; id < next_id; id++)
+    if (!living[id]) unmarked.push_back(id);
+  if (unmarked.size() == untaken) return;
+
+  free_ids = std::move(unmarked);
+  free_taken = 0;
+  for (size_t i = 0; i < capacity; i++)
+    slots[i].state.store(0, std::memory_order_relaxed);
+  for (size_t id = 0; id < next_id; id++)
+    if (living[id]) insert_assigned(id_keys[id], id);
+}
+
+template class BasicIdRemapper<uint32_t>;
+template class BasicIdRemapper<uint64_t>;
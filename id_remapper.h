@@ -0,0 +1,105 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef ONLINE_CACHE_SIMULATOR_ID_REMAPPER_H_
+#define ONLINE_CACHE_SIMULATOR_ID_REMAPPER_H_
+
+#include <atomic>      // for atomic
+#include <cassert>     // for assert
+#include <cstddef>     // for size_t
+#include <cstdint>     // for uint64_t
+#include <memory>      // for unique_ptr
+#include <vector>      // for vector
+
+#include "cache_sim.h" // for req_count_t
+
+// Batches of at least this many keys are renamed in parallel
+constexpr size_t kParallelRenameKeys = 1 << 14;
+
+// Table capacity is at least this many times the number of ids that may be assigned
+constexpr size_t kRemapLoadFactor = 2;
+
+/*
+ * Renames 64 bit keys to dense ids of type Id from 0, so traces of 64 bit keys run with 32 bit
+ * ids and the dense LastAccessTable. Keys are held in an open addressing table with
+ * linear probing that threads may insert into concurrently. Ids of keys that are no longer
+ * needed may be recycled for new keys.
+ * Instantiated for uint32_t and uint64_t ids.
+ */
+template <typename Id>
+class BasicIdRemapper {
+ private:
+  // state is 0 for an empty slot, 1 while the inserting thread assigns an id, and the id + 2
+  // once the key and id may be read
+  struct Slot {
+    std::atomic<uint64_t> key;
+    std::atomic<uint64_t> state;
+  };
+  std::unique_ptr<Slot[]> slots;
+  size_t capacity = 0;
+  size_t shift = 64;
+
+  std::vector<uint64_t> id_keys;     // key of each id, for rebuilding the table
+  std::atomic<uint64_t> next_id{0};  // ids from here have never been assigned
+  std::vector<Id> free_ids;          // recycled ids, handed out from free_taken
+  std::atomic<size_t> free_taken{0};
+  std::vector<uint8_t> living;       // scratch of recycle()
+
+  Id take_id();
+  void insert_assigned(uint64_t key, Id id);
+  void rebuild(size_t min_capacity);
+  void recycle_unmarked();
+ public:
+  BasicIdRemapper() { rebuild(kRemapLoadFactor); }
+  BasicIdRemapper(const BasicIdRemapper& other) { *this = other; }
+  BasicIdRemapper& operator=(const BasicIdRemapper& other);
+
+  // Make room to rename num new keys. Must not be called while keys are being renamed.
+  void reserve(size_t num);
+
+  // The id of key, assigning it the next free id if it has none. Thread safe between calls
+  // to reserve(), which must allow for every new key.
+  Id rename(uint64_t key);
+
+  // Rename num keys into ids, in parallel if there are many
+  void rename(const uint64_t* keys, size_t num, Id* ids);
+
+  // Number of ids ever assigned, every id is below this
+  uint64_t get_id_bound() const { return next_id; }
+
+  /*
+   * Free the ids of every key except those of the living requests, whose addrs are ids.
+   * Freed keys are forgotten and their ids are handed to new keys.
+   */
+  template <typename Request>
+  void recycle(const std::vector<Request>& living_requests) {
+    living.assign(next_id, false);
+    for (auto& req : living_requests) {
+      assert(req.addr < next_id);
+      living[req.addr] = true;
+    }
+    recycle_unmarked();
+  }
+};
+
+// Renames keys to ids of the default width
+using IdRemapper = BasicIdRemapper<req_count_t>;
+
+#endif  // ONLINE_CACHE_SIMULATOR_ID_REMAPPER_H_
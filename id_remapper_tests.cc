@@ -0,0 +1,97 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "bounded_iaf.h"
+#include "container_cache_sim.h"
+#include "id_remapper.h"
+#include "sim_factory.h"
+#include "test_traces.h"
+#include "trace_format.h"
+
+TEST(IdRemapperTests, IdRemapper) {
+  // keys renamed concurrently get one dense id each
+  std::mt19937_64 gen(47);
+  std::vector<uint64_t> key_set(50'000);
+  for (auto& key : key_set) key = gen();
+  std::vector<uint64_t> keys(4 * kParallelRenameKeys);
+  for (auto& key : keys) key = key_set[gen() % key_set.size()];
+  IdRemapper remapper;
+  std::vector<req_count_t> ids(keys.size());
+  remapper.rename(keys.data(), keys.size(), ids.data());
+  std::unordered_map<uint64_t, req_count_t> id_of;
+  std::unordered_set<req_count_t> used;
+  for (size_t i = 0; i < keys.size(); i++) {
+    auto [it, inserted] = id_of.emplace(keys[i], ids[i]);
+    ASSERT_EQ(it->second, ids[i]);
+    if (inserted) {
+      ASSERT_TRUE(used.insert(ids[i]).second);
+    }
+  }
+  ASSERT_EQ(remapper.get_id_bound(), id_of.size());
+
+  // 64 bit keys renamed by BoundedIAF, whose ids are recycled, match the original trace
+  std::vector<req_count_t> trace = skewed_trace(200'000, 20'000, 48);
+  constexpr size_t kLimit = 1000;
+  ContainerCacheSim truth_sim;
+  BoundedIAF bounded(4096, kLimit);
+  for (size_t i = 0; i < trace.size(); i += 100) {
+    std::vector<uint64_t> batch;
+    for (size_t j = i; j < i + 100; j++)
+      batch.push_back(trace[j] * 0x9E3779B97F4A7C15ull + 1);
+    if (i % 200 == 0) {
+      bounded.key_batch_access(batch.data(), batch.size());
+    } else {
+      for (auto key : batch) bounded.key_access(key);
+    }
+  }
+  CacheSim::SuccessVector truth = run_trace(truth_sim, trace);
+  truth.resize(kLimit + 1);
+  ASSERT_EQ(bounded.get_success_function(), truth);
+}
+
+TEST(IdRemapperTests, WideTraceKeys) {
+  // a binary trace of 64 bit hashes is replayed as keys through BOUND_IAF with 32 bit ids
+  std::vector<req_count_t> trace = skewed_trace(200'000, 20'000, 49);
+  std::string path = testing::TempDir() + "/iaf_wide_keys" + kTraceExtension;
+  TraceWriter writer(path);
+  for (auto addr : trace)
+    writer.append(addr * 0x9E3779B97F4A7C15ull | (1ull << 40));
+  ASSERT_TRUE(writer.close());
+  TraceReader reader;
+  ASSERT_TRUE(reader.open(path));
+  ASSERT_GT(reader.get_max_addr(), UINT32_MAX);
+
+  TraceBounds bounds{reader.get_max_addr(), reader.get_num_accesses(), true};
+  std::unique_ptr<CacheSim> renamed = new_simulator(BOUND_IAF, 4096, 0, tuned_config(), &bounds);
+  ASSERT_EQ(renamed->get_max_id(), UINT32_MAX);
+  ASSERT_FALSE(reader.replay(*renamed));
+  ASSERT_TRUE(reader.replay(*renamed, true));
+
+  BasicBoundedIAF<uint64_t, uint64_t, uint64_t> wide(4096);
+  ASSERT_TRUE(reader.replay(wide));
+  ASSERT_EQ(renamed->get_success_function(), wide.get_success_function());
+}
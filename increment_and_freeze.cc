@@ -19,51 +19,301 @@
 
 #include "increment_and_freeze.h"
 
-#include <algorithm>
+#include <fcntl.h>
+#include <immintrin.h>
 #include <omp.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <utility>
 
-void IncrementAndFreeze::memory_access(req_count_t addr) {
+#include "external_ops.h"
+#include "last_access_index.h"
+#include "prefix_sum.h"
+#include "radix_sort.h"
+
+void id_width_error(uint64_t id, uint64_t max_id) {
+  std::cerr << "ERROR: id " << id << " does not fit the " << 64 - __builtin_clzll(max_id)
+            << " bit ids of the simulator" << std::endl;
+  exit(EXIT_FAILURE);
+}
+
+template <typename Addr, typename Time, typename Count>
+void BasicIncrementAndFreeze<Addr, Time, Count>::memory_access(uint64_t addr) {
+  if (addr > std::numeric_limits<Addr>::max()) id_width_error(addr, get_max_id());
   ++access_number;
-  requests.push_back({addr, (req_count_t) requests.size() + 1});
+  requests.push_back({(Addr) addr, (Time) requests.size() + 1});
+  if (requests.size() >= segment_size) process_segment();
+}
+
+template <typename Addr, typename Time, typename Count>
+void BasicIncrementAndFreeze<Addr, Time, Count>::extent_access(uint64_t first_addr, size_t num_blocks) {
+  access_number += num_blocks;
+  while (num_blocks > 0) {
+    size_t piece = std::min(segment_size - requests.size(), num_blocks);
+    append_extent(requests, first_addr, piece);
+    first_addr += piece;
+    num_blocks -= piece;
+    if (requests.size() >= segment_size) process_segment();
+  }
+}
+
+template <typename Addr, typename Time, typename Count>
+void BasicIncrementAndFreeze<Addr, Time, Count>::key_access(uint64_t key) {
+  ++access_number;
+  append_keys(requests, &key, 1);
+  if (requests.size() >= segment_size) process_segment();
+}
+
+template <typename Addr, typename Time, typename Count>
+void BasicIncrementAndFreeze<Addr, Time, Count>::key_batch_access(const uint64_t* keys, size_t num) {
+  access_number += num;
+  while (num > 0) {
+    size_t piece = std::min(segment_size - requests.size(), num);
+    append_keys(requests, keys, piece);
+    keys += piece;
+    num -= piece;
+    if (requests.size() >= segment_size) process_segment();
+  }
+}
+
+template <typename Addr, typename Time, typename Count>
+void BasicIncrementAndFreeze<Addr, Time, Count>::append_keys(std::vector<request>& reqs,
+                                                      const uint64_t* keys, size_t num) {
+  if (!remapper) remapper.emplace();
+  if (num == 1) {
+    remapper->reserve(1);
+    reqs.push_back({remapper->rename(*keys), (Time) reqs.size() + 1});
+    return;
+  }
+  renamed.resize(num);
+  remapper->rename(keys, num, renamed.data());
+  size_t begin = reqs.size();
+  reqs.resize(begin + num);
+  for (size_t i = 0; i < num; i++)
+    reqs[begin + i] = {renamed[i], (Time)(begin + i + 1)};
 }
 
-req_count_t IncrementAndFreeze::populate_operations(
+namespace {
+template <typename Request, typename Addr, typename Time>
+void fill_extent_scalar(Request* out, Addr addr, Time access, size_t num) {
+  for (size_t i = 0; i < num; i++)
+    out[i] = {(Addr)(addr + i), (Time)(access + i)};
+}
+
+// Each vector holds consecutive requests and is advanced by adding the number it holds to
+// every lane. Addr and Time must be of the same width.
+template <typename Request, typename Addr, typename Time>
+__attribute__((target("avx2")))
+void fill_extent_avx2(Request* out, Addr addr, Time access, size_t num) {
+  static_assert(sizeof(Addr) == sizeof(Time));
+  constexpr size_t kPerVector = sizeof(__m256i) / sizeof(Request);
+  __m256i next, step;
+  if constexpr (sizeof(Addr) == 8) {
+    next = _mm256_setr_epi64x(addr, access, addr + 1, access + 1);
+    step = _mm256_set1_epi64x(kPerVector);
+  } else {
+    next = _mm256_setr_epi32(addr, access, addr + 1, access + 1,
+                             addr + 2, access + 2, addr + 3, access + 3);
+    step = _mm256_set1_epi32(kPerVector);
+  }
+  size_t i = 0;
+  for (; i + kPerVector <= num; i += kPerVector) {
+    _mm256_storeu_si256((__m256i*)(out + i), next);
+    if constexpr (sizeof(Addr) == 8) next = _mm256_add_epi64(next, step);
+    else next = _mm256_add_epi32(next, step);
+  }
+  for (; i < num; i++)
+    out[i] = {(Addr)(addr + i), (Time)(access + i)};
+}
+}  // namespace
+
+template <typename Addr, typename Time, typename Count>
+auto BasicIncrementAndFreeze<Addr, Time, Count>::extent_filler_for(SimdLevel level) -> ExtentFiller {
+  if constexpr (sizeof(Addr) == sizeof(Time))
+    if (level >= SIMD_AVX2) return fill_extent_avx2<request, Addr, Time>;
+  return fill_extent_scalar<request, Addr, Time>;
+}
+
+template <typename Addr, typename Time, typename Count>
+void BasicIncrementAndFreeze<Addr, Time, Count>::radix_sort_requests(std::vector<request> &reqs) {
+  Addr max_addr = 0;
+  Time max_access = 0;
+  size_t out_of_order = 0;
+#pragma omp parallel for reduction(max:max_addr, max_access) reduction(+:out_of_order)
+  for (size_t i = 0; i < reqs.size(); i++) {
+    max_addr = std::max(max_addr, reqs[i].addr);
+    max_access = std::max(max_access, reqs[i].access_number);
+    out_of_order += i > 0 && reqs[i-1].access_number > reqs[i].access_number;
+  }
+  const size_t addr_bits = num_bits(max_addr);
+  const size_t time_bits = num_bits(max_access);
+
+  // Requests are usually given in access order. Then a stable sort by addr is sufficient.
+  const size_t time_sort_bits = out_of_order == 0 ? 0 : time_bits;
+
+  if (addr_bits + time_bits > 64) {
+    // cannot pack so sort by access_number and then stably by addr
+    std::vector<request> scratch;
+    parallel_radix_sort(reqs, scratch, 0, time_sort_bits,
+                        [](const request& r) { return r.access_number; });
+    parallel_radix_sort(reqs, scratch, 0, addr_bits, [](const request& r) { return r.addr; });
+    return;
+  }
+
+  // pack each request into a key of the form addr|access_number
+  STARTTIME(pack_keys);
+  std::vector<uint64_t> keys(reqs.size());
+#pragma omp parallel for
+  for (size_t i = 0; i < reqs.size(); i++)
+    keys[i] = ((uint64_t)reqs[i].addr << time_bits) | reqs[i].access_number;
+  STOPTIME(pack_keys);
+
+  STARTTIME(radix_sort_keys);
+  std::vector<uint64_t> scratch;
+  parallel_radix_sort(keys, scratch, time_bits - time_sort_bits, addr_bits + time_bits,
+                      [](uint64_t key) { return key; });
+  STOPTIME(radix_sort_keys);
+
+  STARTTIME(unpack_keys);
+  const uint64_t time_mask = ((uint64_t)1 << time_bits) - 1;
+#pragma omp parallel for
+  for (size_t i = 0; i < reqs.size(); i++)
+    reqs[i] = request(keys[i] >> time_bits, keys[i] & time_mask);
+  STOPTIME(unpack_keys);
+}
+
+template <typename Addr, typename Time, typename Count>
+void BasicIncrementAndFreeze<Addr, Time, Count>::sort_requests(std::vector<request> &reqs, SortEngine engine) {
+  switch (engine) {
+    case STD_SORT:
+      std::sort(reqs.begin(), reqs.end());
+      break;
+    case RADIX_SORT:
+      radix_sort_requests(reqs);
+      break;
+  }
+}
+
+template <typename Addr, typename Time, typename Count>
+bool BasicIncrementAndFreeze<Addr, Time, Count>::in_access_order(const std::vector<request> &reqs) {
+  size_t out_of_order = 0;
+#pragma omp parallel for reduction(+:out_of_order)
+  for (size_t i = 0; i < reqs.size(); i++)
+    out_of_order += reqs[i].access_number != i + 1;
+  return out_of_order == 0;
+}
+
+template <typename Addr, typename Time, typename Count>
+Time BasicIncrementAndFreeze<Addr, Time, Count>::populate_operations(
     std::vector<request> &reqs, std::vector<request> *living_req) {
 
   reqs.resize(reqs.size()); // get rid of empty requests to save memory
 
-  STARTTIME(sort_requests);
-  // sort requests by request id and then by access_number
-  std::sort(reqs.begin(), reqs.end());
-  STOPTIME(sort_requests);
+  // last_access[i] is the access_number of the previous request to the id of
+  // access_number i+1, or 0 if there is none.
+  STARTTIME(allocate_last_access);
+  std::vector<Time> last_access(reqs.size());
+  STOPTIME(allocate_last_access);
+
+  Time unique_ids;
+  if (config.op_builder == LAST_ACCESS_INDEX && in_access_order(reqs))
+    unique_ids = index_find_last_access(reqs, last_access, living_req);
+  else
+    unique_ids = sort_find_last_access(reqs, last_access, living_req);
+
+  // Only the encoding in use holds operations, the other is freed
+  STARTTIME(emit_ops);
+  if (use_compact_ops(reqs.size())) {
+    std::vector<TimeOp>().swap(operations);
+    emit_operations(last_access, compact_operations);
+    memory_usage = sizeof(CompactOp) * compact_operations.size();
+  }
+  else {
+    std::vector<CompactOp>().swap(compact_operations);
+    emit_operations(last_access, operations);
+    memory_usage = sizeof(TimeOp) * operations.size(); // update memory usage of IncrementAndFreeze
+  }
+  STOPTIME(emit_ops);
+  return unique_ids;
+}
+
+template <typename Addr, typename Time, typename Count>
+template <typename OpT>
+void BasicIncrementAndFreeze<Addr, Time, Count>::emit_operations(const std::vector<Time> &last_access,
+                                                          std::vector<OpT>& operations) {
+  // Every request creates a Prefix and, if it has a previous access, a Postfix.
+  // The Prefix of access_number 1 targets 0 and is therefore the leading Null.
+  // Each thread counts the operations of a contiguous block of requests, an exclusive
+  // scan of the counts gives where each block begins, and then the blocks are written.
+  const size_t num_reqs = last_access.size();
+  std::vector<size_t> block_start(omp_get_max_threads() + 1);
+#pragma omp parallel
+  {
+    const size_t num_threads = omp_get_num_threads();
+    const size_t tid = omp_get_thread_num();
+    const Time begin = num_reqs * tid / num_threads;
+    const Time end = num_reqs * (tid + 1) / num_threads;
 
-  // Size of operations array is bounded by 2*reqs
-  operations.clear();
-  STARTTIME(allocate_ops)
-  operations.resize(2*reqs.size());
-  STOPTIME(allocate_ops);
+    size_t num_ops = 0;
+    for (Time i = begin; i < end; i++)
+      num_ops += 1 + (last_access[i] != 0);
+    block_start[tid + 1] = num_ops;
 
-  STARTTIME(build_op_array);
-  req_count_t unique_ids = 0;
+#pragma omp barrier
+#pragma omp single
+    {
+      for (size_t t = 0; t < num_threads; t++)
+        block_start[t + 1] += block_start[t];
+      operations.clear();
+      operations.resize(std::max(block_start[num_threads], (size_t)1)); // at least leading Null
+    } // implicit barrier
+
+    size_t place_idx = block_start[tid];
+    for (Time i = begin; i < end; i++) {
+      Time access_num = i + 1;
+      if (last_access[i] != 0) {
+        operations[place_idx++] = OpT(access_num-1, -1);   // Prefix  i-1, +1, Full -1
+        operations[place_idx++] = OpT(last_access[i]);     // Postfix prev(i), +1, Full 0
+      }
+      else {
+        operations[place_idx++] = OpT(access_num-1, 0);    // Prefix  i-1, +1, Full 0
+      }
+    }
+  }
+  assert(operations[0].is_null());
+}
+
+template <typename Addr, typename Time, typename Count>
+Time BasicIncrementAndFreeze<Addr, Time, Count>::sort_find_last_access(std::vector<request> &reqs,
+    std::vector<Time> &last_access, std::vector<request> *living_req) {
+  STARTTIME(sort_reqs);
+  // sort requests by request id and then by access_number
+  sort_requests(reqs, config.sort_engine);
+  STOPTIME(sort_reqs);
+
+  STARTTIME(find_last_access);
+  Time unique_ids = 0;
 #pragma omp parallel reduction(+:unique_ids)
   {
     std::vector<request> living_req_priv;
 #pragma omp for nowait // nowait removes the barrier, so the critical copying can happen ASAP
-    for (req_count_t i = 0; i < reqs.size(); i++) {
+    for (size_t i = 0; i < reqs.size(); i++) {
       auto [addr, access_num] = reqs[i];
       auto [last_addr, last_access_num] = i == 0 ? request(0, 0): reqs[i-1];
 
       // Using last, check if previous sorted access is the same
       if (last_access_num > 0 && addr == last_addr) {
-        // prev is same id as us so create Prefix and Postfix
-        operations[2*access_num-2] = Op(access_num-1, -1); // Prefix  i-1, +1, Full -1
-        operations[2*access_num-1] = Op(last_access_num);  // Postfix prev(i), +1, Full 0
+        last_access[access_num-1] = last_access_num;
       }
       else {
         // previous access is different. This is therefore first access to this id
-        // so only create Prefix.
-        operations[2*access_num-2] = Op(access_num-1, 0); // Prefix  i-1, +1, Full 0
+        last_access[access_num-1] = 0;
         ++unique_ids;
 
         // The previous request survives this chunk so add to living
@@ -80,17 +330,7 @@ req_count_t IncrementAndFreeze::populate_operations(
           std::make_move_iterator(living_req_priv.end()));
     }
   }
-  // Compact operations vector
-  req_count_t place_idx = 1;
-  for (req_count_t cur_idx = 1; cur_idx < operations.size(); cur_idx++) {
-    if (!operations[cur_idx].is_null()) {
-      operations[place_idx] = operations[cur_idx];
-      place_idx++;
-    }
-  }
-  operations.resize(place_idx); // shrink down to remove nulls at end
-  memory_usage = sizeof(Op) * operations.size(); // update memory usage of IncrementAndFreeze
-  STOPTIME(build_op_array);
+  STOPTIME(find_last_access);
 
   if (living_req == nullptr)
     return unique_ids;
@@ -100,19 +340,116 @@ req_count_t IncrementAndFreeze::populate_operations(
 
   // sort by access number
   STARTTIME(sort_new_living);
-  std::sort(living_req->begin(), living_req->end(), [](auto &left, auto &right) {
-    return left.access_number < right.access_number;
-  });
+  if (config.sort_engine == RADIX_SORT) {
+    std::vector<request> scratch;
+    parallel_radix_sort(*living_req, scratch, 0, num_bits(reqs.size()),
+                        [](const request& r) { return r.access_number; });
+  } else {
+    std::sort(living_req->begin(), living_req->end(), [](auto &left, auto &right) {
+      return left.access_number < right.access_number;
+    });
+  }
   STOPTIME(sort_new_living);
   return unique_ids;
 }
 
+// Find the previous access of requests [begin, end) which must be in access order.
+// index gives the last access to each id seen so far.
+// Sets has_next[i] for every request i that is accessed again.
+// Returns the number of unique ids in [begin, end)
+template <typename Index, typename Request, typename Time>
+static Time index_find_partition(Index &index, const Request *begin, const Request *end,
+                                 std::vector<Time> &last_access, std::vector<uint8_t> &has_next) {
+  Time unique_ids = 0;
+  for (auto it = begin; it != end; ++it) {
+    auto [addr, access_num] = *it;
+    Time last_access_num = index.exchange(addr, access_num);
+    last_access[access_num-1] = last_access_num;
+
+    if (last_access_num > 0)
+      has_next[last_access_num-1] = true;
+    else
+      ++unique_ids;
+  }
+  return unique_ids;
+}
+
+template <typename Addr, typename Time, typename Count>
+Time BasicIncrementAndFreeze<Addr, Time, Count>::index_find_last_access(std::vector<request> &reqs,
+    std::vector<Time> &last_access, std::vector<request> *living_req) {
+  const size_t num_reqs = reqs.size();
+  const size_t num_threads = omp_get_max_threads();
+
+  Addr max_addr = 0;
+#pragma omp parallel for reduction(max:max_addr)
+  for (size_t i = 0; i < num_reqs; i++)
+    max_addr = std::max(max_addr, reqs[i].addr);
+  const bool dense = max_addr / kDenseUniverseFactor < num_reqs;
+
+  // Group the requests by the partition that owns their id. This is a single stable
+  // bucketing pass so each partition remains in access order.
+  STARTTIME(partition_reqs);
+  const size_t num_partitions = num_threads == 1 ? 1 : std::min(kRadixBuckets, 4 * num_threads);
+  std::vector<request> partitioned;
+  const request *part_reqs = reqs.data();
+  size_t part_starts[kRadixBuckets + 1] = {0, num_reqs};
+  if (num_partitions > 1) {
+    partitioned.resize(num_reqs);
+    auto owner = [&](const request& r) { return addr_partition(r.addr, num_partitions); };
+    if (radix_pass(reqs.data(), partitioned.data(), num_reqs, owner, part_starts))
+      part_reqs = partitioned.data();
+  }
+  STOPTIME(partition_reqs);
+
+  STARTTIME(find_last_access);
+  std::vector<Time> table;
+  if (dense) table.resize(max_addr + 1);
+  std::vector<uint8_t> has_next(num_reqs);
+  Time unique_ids = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+:unique_ids)
+  for (size_t p = 0; p < num_partitions; p++) {
+    const request *begin = part_reqs + part_starts[p];
+    const request *end = part_reqs + part_starts[p + 1];
+    if (dense) {
+      LastAccessTable index(table);
+      unique_ids += index_find_partition(index, begin, end, last_access, has_next);
+    } else {
+      LastAccessMap<Addr, Time> index(end - begin);
+      unique_ids += index_find_partition(index, begin, end, last_access, has_next);
+    }
+  }
+  STOPTIME(find_last_access);
+
+  if (living_req == nullptr)
+    return unique_ids;
+
+  // Requests that are not accessed again survive this chunk. Each thread collects
+  // a contiguous range so concatenating in thread order gives access order.
+  STARTTIME(collect_living);
+#pragma omp parallel
+  {
+    std::vector<request> living_req_priv;
+#pragma omp for schedule(static) nowait
+    for (size_t i = 0; i < num_reqs; i++) {
+      if (!has_next[i]) living_req_priv.push_back(reqs[i]);
+    }
+#pragma omp for ordered schedule(static, 1)
+    for (int t = 0; t < omp_get_num_threads(); t++) {
+#pragma omp ordered
+      living_req->insert(living_req->end(), living_req_priv.begin(), living_req_priv.end());
+    }
+  }
+  STOPTIME(collect_living);
+  return unique_ids;
+}
+
 // 'Main' function of IAF. Used to update a hits vector given a vector of requests
-void IncrementAndFreeze::update_hits_vector(std::vector<request>& reqs,
-  SuccessVector& hits_vector, std::vector<request> *living_req) {
+template <typename Addr, typename Time, typename Count>
+void BasicIncrementAndFreeze<Addr, Time, Count>::update_hits_vector(std::vector<request>& reqs,
+  HitsVector& hits_vector, std::vector<request> *living_req) {
   STARTTIME(update_hits_vector);
   STARTTIME(create_operations)
-  req_count_t unique_ids = populate_operations(reqs, living_req);
+  Time unique_ids = populate_operations(reqs, living_req);
   STOPTIME(create_operations);
 
   STARTTIME(resize_hits_vector);
@@ -123,14 +460,11 @@ void IncrementAndFreeze::update_hits_vector(std::vector<request>& reqs,
 
   // begin the recursive process
   STARTTIME(projections);
-  ProjSequence init_seq(1, reqs.size(), operations.begin(), operations.size());
-
-  // We want to spin up a bunch of threads, but only start with 1.
-  // More will be added in by do_projections.
-#pragma omp parallel
-#pragma omp single
-  do_projections(hits_vector, std::move(init_seq));
-
+  if (use_compact_ops(reqs.size()))
+    run_projections(hits_vector, compact_operations.data(), compact_operations.size(),
+                    reqs.size());
+  else
+    run_projections(hits_vector, operations.data(), operations.size(), reqs.size());
   STOPTIME(projections);
   STOPTIME(update_hits_vector);
 
@@ -141,107 +475,325 @@ void IncrementAndFreeze::update_hits_vector(std::vector<request>& reqs,
   // std::cout << std::endl;
 }
 
+template <typename Addr, typename Time, typename Count>
+template <typename OpT>
+void BasicIncrementAndFreeze<Addr, Time, Count>::run_projections(HitsVector& hits_vector, OpT* ops, size_t num_ops,
+                                                          Time num_reqs) {
+  // Stack depths are counted in per-worker histograms to avoid contention upon the
+  // small depths that receive most of the hits. The histograms are zero between chunks.
+  const size_t num_workers = scheduler->num_workers();
+  const size_t num_local = std::min(hits_vector.size(), kIafLocalHits);
+  if (local_hits.size() < num_workers)
+    local_hits.resize(num_workers);
+  for (auto& local : local_hits)
+    if (local.size() < num_local) local.resize(num_local);
+
+  // Spawn enough tasks to balance the load but no more
+  task_cutoff = config.task_cutoff;
+  if (task_cutoff == 0)
+    task_cutoff = std::max(base_case_size, num_reqs / (kIafTasksPerWorker * num_workers));
+
+  ProjSequence<OpT> init_seq(1, num_reqs, ops, num_ops);
+  scheduler->run([&]() { (this->*projections_of<OpT>())(hits_vector, init_seq); });
+
+  // Merge the per-worker histograms into hits_vector and zero them.
+  // Entries at or beyond hits_vector.size() were never incremented.
+  scheduler->parallel_for(num_local, kIafLocalHits / 16, [&](size_t begin, size_t end) {
+    for (auto& local : local_hits) {
+      for (size_t i = begin; i < end; i++) {
+        hits_vector[i] += local[i];
+        local[i] = 0;
+      }
+    }
+  });
+}
+
 //recursively (and in parallel) perform all the projections
-void IncrementAndFreeze::do_projections(SuccessVector& hits_vector, ProjSequence cur) {
+template <typename Addr, typename Time, typename Count>
+template <size_t kBranching, typename OpT>
+void BasicIncrementAndFreeze<Addr, Time, Count>::do_projections(HitsVector& hits_vector, ProjSequence<OpT> cur) {
+  // projections of a mapped op file that fit in memory are copied there
+  const bool mapped = cur.op_seq >= mapped_begin && cur.op_seq < mapped_end;
+  if (mapped && cur.num_ops <= paged_ops_limit) {
+    do_paged_projections<kBranching, OpT>(hits_vector, cur);
+    return;
+  }
+  if (mapped) {
+#pragma omp atomic update
+    io_stats->streamed_bytes += cur.num_ops * sizeof(OpT);
+#pragma omp atomic update
+    io_stats->mapped_nodes++;
+  }
+
   // base case
-  // brute force algorithm to solve problems of size <= kIafBaseCase
-  if (cur.end - cur.start < kIafBaseCase) {
-    do_base_case(hits_vector, cur);
+  // solve problems of size <= base_case_size without recursion
+  if (cur.end - cur.start < base_case_size) {
+    do_base_case<OpT>(hits_vector, cur);
     return;
   }
   else {
-    req_count_t dist = cur.end - cur.start + 1;
-    double num_partitions = std::min(dist, (req_count_t) kIafBranching);
-
-    // This biased toward making right side projects larger which is good
-    // because they shrink while left gets bigger
-    double split_amount = dist / num_partitions;
-    double fractional_end = cur.end;
-    // std::cout << "distance = " << dist << " partitions = " << num_partitions << " split_amnt = " << split_amount << std::endl;
-
-    PartitionState state(split_amount, cur.num_ops);
+    PartitionState<kBranching, OpT> state(cur.start, cur.end, cur.num_ops,
+                                          base_case_size / kIafSmallNodeSplit + 1);
 
     // split off a portion of the projected sequence
-    ProjSequence remaining_sequence(0,0);
-    for (size_t i = num_partitions - 1; i > 0; i--) {
-      fractional_end -= split_amount;
-      // std::cout << "fractional_end = " << fractional_end << std::endl;
-      assert(fractional_end >= cur.start);
+    ProjSequence<OpT> remaining_sequence(0,0);
+    for (size_t i = state.num_partitions() - 1; i > 0; i--) {
+      typename OpT::Time split_start = state.partition_start(i);
+      assert(split_start > cur.start);
 
       // split off rightmost portion of current sequence
-      ProjSequence split_sequence(fractional_end + 1, cur.end);
-      remaining_sequence = std::move(ProjSequence(cur.start, fractional_end));
+      ProjSequence<OpT> split_sequence(split_start, cur.end);
+      remaining_sequence = std::move(ProjSequence<OpT>(cur.start, split_start - 1));
       cur.partition(remaining_sequence, split_sequence, i, state);
       cur = std::move(remaining_sequence);
 
-      // create a task to process split off sequence
-#pragma omp task shared(hits_vector) mergeable final(dist <= 8192)
-      do_projections(hits_vector, std::move(split_sequence));
+      // create a task to process split off sequence if it is large enough
+      if (!solving_paged && split_sequence.end - split_sequence.start + 1 > task_cutoff)
+        scheduler->spawn([this, &hits_vector, split_sequence]() {
+          do_projections<kBranching, OpT>(hits_vector, split_sequence);
+        });
+      else
+        do_projections<kBranching, OpT>(hits_vector, std::move(split_sequence));
     }
 
     // process remaining projected sequence
-    do_projections(hits_vector, std::move(cur));
+    do_projections<kBranching, OpT>(hits_vector, std::move(cur));
   }
 }
 
-void IncrementAndFreeze::do_base_case(SuccessVector& hits_vector, ProjSequence cur) {
-  int64_t full_amnt = 0;
-  size_t local_distances[kIafBaseCase];
-  std::fill(local_distances, local_distances+kIafBaseCase, 0);
+template <typename Addr, typename Time, typename Count>
+template <size_t kBranching, typename OpT>
+void BasicIncrementAndFreeze<Addr, Time, Count>::do_paged_projections(HitsVector& hits_vector,
+                                                               ProjSequence<OpT> cur) {
+#pragma omp atomic update
+  io_stats->paged_in_bytes += cur.num_ops * sizeof(OpT);
+#pragma omp atomic update
+  io_stats->paged_in_projections++;
 
-  for (req_count_t i = 0; i < cur.num_ops; i++) {
-    Op &op = cur.op_seq[i];
+  std::vector<OpT> paged(cur.op_seq, cur.op_seq + cur.num_ops);
+  ProjSequence<OpT> seq(cur.start, cur.end, paged.data(), cur.num_ops);
+  solving_paged = true;
+  do_projections<kBranching, OpT>(hits_vector, seq);
+  solving_paged = false;
+}
 
-    switch(op.get_type()) {
-      case Prefix:
-        for (req_count_t j = cur.start; j <= op.get_target(); j++)
-          local_distances[j - cur.start] += op.get_inc_amnt();
-        break;
+template <typename Addr, typename Time, typename Count>
+template <typename OpT>
+auto BasicIncrementAndFreeze<Addr, Time, Count>::projections_for(size_t branching) -> ProjectionsFn<OpT> {
+  static const auto table = projections_table<OpT>(std::make_index_sequence<kNumIafBranchings>());
+  for (size_t i = 0; i < kNumIafBranchings; i++)
+    if (kIafBranchings[i] == branching) return table[i];
+
+  std::cerr << "ERROR: Unsupported branching factor " << branching << ". Must be one of ";
+  for (size_t i = 0; i < kNumIafBranchings; i++)
+    std::cerr << kIafBranchings[i] << (i + 1 < kNumIafBranchings ? ", " : ".");
+  std::cerr << std::endl;
+  exit(EXIT_FAILURE);
+}
 
-      case Postfix:
-        for (req_count_t j = std::max(op.get_target(), cur.start); j <= cur.end; j++)
-          local_distances[j - cur.start] += op.get_inc_amnt();
+template <typename Addr, typename Time, typename Count>
+BasicIncrementAndFreeze<Addr, Time, Count>::BasicIncrementAndFreeze(IafConfig config)
+    : config(config), base_case_size(std::max(config.base_case_size, (size_t)1)),
+      scheduler(config.scheduler),
+      projections(projections_for<TimeOp>(config.branching)),
+      compact_projections(projections_for<CompactOp>(config.branching)) {
+  segment_size = config.segment_size == 0 ? TimeOp::max_requests
+                                          : std::min(config.segment_size, TimeOp::max_requests);
+  if (config.base_case_solver == BRUTE_FORCE)
+    base_case_size = std::min(base_case_size, kMaxBruteBaseCase);
+  choose_kernels(op_kernels);
+  choose_kernels(compact_op_kernels);
+  extent_filler = extent_filler_for(std::min(config.max_simd, detect_simd_level()));
+}
 
-        // Freeze target by incrementing hits_vector[stack_depth]
-        if (op.get_target() != 0) {
-          int64_t hit = local_distances[op.get_target() - cur.start] + full_amnt;
-          // std::cout << "Freezing " << op << " = " << hit << std::endl;
-          assert(hit > 0);
-          assert((size_t)hit < hits_vector.size());
+template <typename Addr, typename Time, typename Count>
+template <typename OpT>
+void BasicIncrementAndFreeze<Addr, Time, Count>::do_base_case(HitsVector& hits_vector, ProjSequence<OpT> cur) {
+  // stack depths of the frozen Postfixes
+  thread_local std::vector<int64_t> depths;
+  if (depths.size() < cur.num_ops) depths.resize(cur.num_ops);
+
+  const BaseCaseKernels<OpT>& kernels = kernels_of<OpT>();
+  BaseCaseKernel<OpT> kernel = cur.num_ops < kNarrowBaseCaseOps ? kernels.narrow : kernels.wide;
+  size_t num_depths = kernel(&cur.op_seq[0], cur.num_ops, cur.start, cur.end, depths.data());
+
+  // Freeze targets by incrementing hits[stack_depth]. Small stack depths go to
+  // this worker's histogram, only the sparse deep ones touch the shared hits_vector.
+  HitsVector& local = local_hits[scheduler->worker_id()];
+  for (size_t i = 0; i < num_depths; i++) {
+    int64_t hit = depths[i];
+    assert(hit > 0);
+    assert((size_t)hit < hits_vector.size());
+    if ((size_t)hit < local.size())
+      local[hit]++;
+    else {
 #pragma omp atomic update
-          hits_vector[hit]++;
-        }
-        break;
-
-      default: // Null
-        break;
+      hits_vector[hit]++;
     }
+  }
+}
 
-    // Add full amount
-    full_amnt += op.get_full_amnt();
+template <typename Addr, typename Time, typename Count>
+CacheSim::SuccessVector BasicIncrementAndFreeze<Addr, Time, Count>::integrate_hits(HitsVector& hits) {
+  STARTTIME(parallel_prefix_sum);
+  // hits[x] tells us the number of requests that are hits for all memory sizes >= x
+  if constexpr (std::is_same_v<HitsVector, SuccessVector>) {
+    // integrate, in place, to convert to success function
+    if (hits.size() > 1)
+      parallel_prefix_sum(&hits[1], &hits[1], hits.size() - 1);
+    STOPTIME(parallel_prefix_sum);
+    return std::move(hits);
+  } else {
+    SuccessVector success(hits.size());
+    if (hits.size() > 1)
+      parallel_prefix_sum(&hits[1], &success[1], hits.size() - 1);
+    STOPTIME(parallel_prefix_sum);
+    return success;
   }
 }
 
-CacheSim::SuccessVector IncrementAndFreeze::get_success_function() {
-  STARTTIME(get_success_fnc);
+template <typename Addr, typename Time, typename Count>
+void BasicIncrementAndFreeze<Addr, Time, Count>::add_hits(std::vector<uint64_t>& sum,
+                                                          const HitsVector& hits) {
+  if (sum.size() < hits.size()) sum.resize(hits.size());
+#pragma omp parallel for
+  for (size_t i = 0; i < hits.size(); i++)
+    sum[i] += hits[i];
+}
 
-  // hits[x] tells us the number of requests that are hits for all memory sizes >= x
-  SuccessVector success;
-  update_hits_vector(requests, success);
+template <typename Addr, typename Time, typename Count>
+void BasicIncrementAndFreeze<Addr, Time, Count>::process_segment() {
+  STARTTIME(process_segment);
+  HitsVector hits;
+  std::vector<request> living;
+  update_hits_vector(requests, hits, &living);
+  add_hits(segment_hits, hits);
+
+  // Leave room for at least as many new requests as there are living ones
+  if (living.size() > segment_size / 2)
+    segment_size = std::min(std::max(2 * living.size(), 2 * segment_size), TimeOp::max_requests);
+  if (living.size() >= segment_size) {
+    std::cerr << "ERROR: " << living.size() << " distinct ids do not leave room for new requests "
+              << "in segments of " << segment_size << " requests" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  // The living requests are in access order. Renumber them from 1 to begin the next segment.
+  size_t num_living = 0;
+  for (auto& living_req : living)
+    living_req.access_number = ++num_living;
+  requests = std::move(living);
+  STOPTIME(process_segment);
+}
 
-  STARTTIME(sequential_prefix_sum);
-  // integrate to convert to success function
-  req_count_t running_count = 0;
-  for (req_count_t i = 1; i < success.size(); i++) {
-    running_count += success[i];
-    success[i] = running_count;
+template <typename Addr, typename Time, typename Count>
+CacheSim::SuccessVector BasicIncrementAndFreeze<Addr, Time, Count>::get_success_function() {
+  STARTTIME(get_success_fnc);
+  HitsVector hits;
+  update_hits_vector(requests, hits);
+  if (segment_hits.empty()) {
+    SuccessVector success = integrate_hits(hits);
+    STOPTIME(get_success_fnc);
+    return success;
   }
-  STOPTIME(sequential_prefix_sum);
+
+  // Combine with the hits of the previous segments, which are kept for later calls
+  SuccessVector success = segment_hits;
+  add_hits(success, hits);
+  if (success.size() > 1)
+    parallel_prefix_sum(&success[1], &success[1], success.size() - 1);
   STOPTIME(get_success_fnc);
   return success;
 }
 
-void IncrementAndFreeze::process_chunk(ChunkInput &input) {
+template <typename Addr, typename Time, typename Count>
+template <typename OpT>
+void BasicIncrementAndFreeze<Addr, Time, Count>::run_mapped_projections(HitsVector& hits_vector, void* data,
+                                                                 const OpFileHeader& header,
+                                                                 size_t memory_budget) {
+  OpT* ops = (OpT*) data;
+  if (header.num_ops * sizeof(OpT) <= memory_budget) {
+    // everything fits so the whole recursion runs in memory, in parallel
+#pragma omp atomic update
+    io_stats->paged_in_bytes += header.num_ops * sizeof(OpT);
+#pragma omp atomic update
+    io_stats->paged_in_projections++;
+    std::vector<OpT> paged(ops, ops + header.num_ops);
+    run_projections(hits_vector, paged.data(), paged.size(), header.num_requests);
+    return;
+  }
+
+  mapped_begin = ops;
+  mapped_end = ops + header.num_ops;
+  // each worker may page in a projection at once
+  paged_ops_limit = memory_budget / (sizeof(OpT) * scheduler->num_workers());
+  run_projections(hits_vector, ops, header.num_ops, header.num_requests);
+  mapped_begin = mapped_end = nullptr;
+  paged_ops_limit = 0;
+}
+
+template <typename Addr, typename Time, typename Count>
+CacheSim::SuccessVector BasicIncrementAndFreeze<Addr, Time, Count>::get_success_function(
+    const std::string& op_path, size_t memory_budget, ExternalIoStats* stats) {
+  STARTTIME(get_success_fnc_mapped);
+  OpFileHeader header;
+  if (!read_op_file_header(op_path, header)) {
+    std::cerr << "ERROR: Could not read op file " << op_path << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  const size_t op_size = header.compact_ops ? sizeof(CompactOp) : sizeof(Op);
+  const size_t file_size = kOpFileDataOffset + header.num_ops * op_size;
+  int fd = open(op_path.c_str(), O_RDWR);
+  struct stat file_stat;
+  if (fd < 0 || fstat(fd, &file_stat) != 0 || (size_t) file_stat.st_size != file_size) {
+    std::cerr << "ERROR: Op file " << op_path << " is truncated or unreadable" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  void* map = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    std::cerr << "ERROR: Could not map op file " << op_path << ": " << strerror(errno)
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  close(fd);
+
+  ExternalIoStats local_stats;
+  io_stats = stats != nullptr ? stats : &local_stats;
+  struct rusage usage_before;
+  getrusage(RUSAGE_SELF, &usage_before);
+
+  HitsVector hits(header.unique_ids + 1);
+  void* data = (char*) map + kOpFileDataOffset;
+  // the Ops of the file are of the default width, and so are CompactOps if ADDR_BIT32
+  if (header.compact_ops || std::is_same_v<Op, CompactOp>) {
+    run_mapped_projections<CompactOp>(hits, data, header, memory_budget);
+  } else if constexpr (std::is_same_v<TimeOp, Op>) {
+    run_mapped_projections<TimeOp>(hits, data, header, memory_budget);
+  } else {
+    std::cerr << "ERROR: Op file " << op_path << " holds Ops wider than the access numbers of "
+              << "this IncrementAndFreeze" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  munmap(map, file_size);
+
+  struct rusage usage_after;
+  getrusage(RUSAGE_SELF, &usage_after);
+  io_stats->block_reads += usage_after.ru_inblock - usage_before.ru_inblock;
+  io_stats->block_writes += usage_after.ru_oublock - usage_before.ru_oublock;
+  io_stats = nullptr;
+
+  SuccessVector success = integrate_hits(hits);
+  STOPTIME(get_success_fnc_mapped);
+  return success;
+}
+
+template <typename Addr, typename Time, typename Count>
+void BasicIncrementAndFreeze<Addr, Time, Count>::process_chunk(ChunkInput &input) {
   input.output.living_requests.clear();
   update_hits_vector(input.requests, input.output.hits_vector, &input.output.living_requests);
 }
+
+template class BasicIncrementAndFreeze<uint32_t, uint32_t, uint32_t>;
+template class BasicIncrementAndFreeze<uint32_t, uint32_t, uint64_t>;
+template class BasicIncrementAndFreeze<uint64_t, uint32_t, uint64_t>;
+template class BasicIncrementAndFreeze<uint64_t, uint64_t, uint64_t>;
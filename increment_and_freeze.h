@@ -23,37 +23,66 @@
 #include <cassert>      // for assert
 #include <cstddef>      // for size_t
 #include <cstdint>      // for uint64_t, uint32_t, int64_t, int32_t
+#include <limits>       // for numeric_limits
 #include <iostream>     // for operator<<, basic_ostream::operator<<, basic_o...
-#include <utility>      // for pair, move, swap
+#include <optional>     // for optional
+#include <string>       // for string
+#include <utility>      // for pair, move, swap, index_sequence
 #include <vector>       // for vector, vector<>::iterator
 #include <array>        // for array
 #include <cmath>        // for ceil
+#include <type_traits>  // for is_same_v
 
+#include "base_case.h"  // for BaseCaseKernel
 #include "iaf_params.h" // for kIafBranching
 #include "cache_sim.h"  // for CacheSim
+#include "id_remapper.h" // for BasicIdRemapper
 #include "op.h"         // for op
 #include "partition.h"  // for partitionstate
 #include "projection.h" // for ProjSequence
+#include "task_scheduler.h" // for SchedulerHandle
+#include "tuning_profile.h" // for tuned_config
 
-// Implements the IncrementAndFreezeInPlace algorithm
-class IncrementAndFreeze: public CacheSim {
+struct ExternalIoStats;
+struct OpFileHeader;
+
+// Report an id above max_id, the largest id of a simulator, and exit
+[[noreturn]] void id_width_error(uint64_t id, uint64_t max_id);
+
+/*
+ * Implements the IncrementAndFreezeInPlace algorithm
+ * Addr:  type of the ids of requests
+ * Time:  type of access numbers, which bounds the number of requests processed at once
+ * Count: type of the hit counts of the hits vector
+ * Instantiated only for the widths declared at the end of this file.
+ */
+template <typename Addr, typename Time, typename Count>
+class BasicIncrementAndFreeze: public CacheSim {
  public:
-  struct request {
-    req_count_t addr;
-    req_count_t access_number;
+  // Packed so that narrow access numbers beside wide ids take 12 bytes rather than 16
+  struct __attribute__((packed, aligned(alignof(Time)))) request {
+    Addr addr;
+    Time access_number;
 
     inline bool operator< (request oth) const {
       return addr < oth.addr || (addr == oth.addr && access_number < oth.access_number);
     }
 
     request() = default;
-    request(req_count_t a, req_count_t n) : addr(a), access_number(n) {}
+    request(Addr a, Time n) : addr(a), access_number(n) {}
   };
-  static_assert(sizeof(request) == 2*sizeof(req_count_t));
+  static_assert(sizeof(request) == sizeof(Addr) + sizeof(Time));
+
+  // Ops whose targets are access numbers. CompactOps are used instead when there are few
+  // requests, and are the same type when Time is 32 bits.
+  using TimeOp = BasicOp<Time>;
+
+  // hits_vector[x] is the number of requests of stack depth x
+  using HitsVector = std::vector<Count>;
 
   struct ChunkOutput {
     std::vector<request> living_requests;
-    std::vector<req_count_t> hits_vector;
+    HitsVector hits_vector;
   };
 
   struct ChunkInput {
@@ -61,56 +90,284 @@ class IncrementAndFreeze: public CacheSim {
     std::vector<request> requests; // living requests and fresh requests
   };
  private:
-  // A vector of all requests
+  // Runtime options for this instance
+  IafConfig config;
+
+  // Projected sequences of fewer requests than this are solved by a base case kernel
+  size_t base_case_size;
+
+  // Base case kernels for the solver and instruction set chosen at construction.
+  // narrow counts distances in 16 bits and is used when there are few ops.
+  template <typename OpT>
+  struct BaseCaseKernels {
+    BaseCaseKernel<OpT> narrow;
+    BaseCaseKernel<OpT> wide;
+  };
+  BaseCaseKernels<TimeOp> op_kernels;
+  BaseCaseKernels<CompactOp> compact_op_kernels;
+
+  // Writes the requests of an extent, the num requests of consecutive addrs and access numbers
+  // from (addr, access). Uses the widest instruction set allowed by config.
+  using ExtentFiller = void (*)(request* out, Addr addr, Time access, size_t num);
+  ExtentFiller extent_filler;
+  static ExtentFiller extent_filler_for(SimdLevel level);
+
+  // Runs the tasks of do_projections. Created at construction and reused for every chunk.
+  SchedulerHandle scheduler;
+
+  // Projected sequences of more requests than this are spawned as tasks
+  size_t task_cutoff;
+
+  // A vector of all requests of the current segment
   std::vector<request> requests;
 
-  // Vector of operations used in ProjSequence to store memory operations
-  std::vector<Op> operations;
+  // Requests are numbered in segments of at most segment_size, the most that Time and TimeOp
+  // permit. When a segment fills, its hits are added to segment_hits and its living requests,
+  // the last access to every id, begin the next segment. So traces of any length are exact.
+  // The segment doubles, up to what TimeOp permits, while the living requests fill half of it.
+  size_t segment_size;
+  std::vector<uint64_t> segment_hits;
+
+  // Process the full segment of requests and carry its living requests into the next.
+  // Exits if the living requests alone fill a segment.
+  void process_segment();
+
+  // Add hits to sum, growing sum if necessary
+  static void add_hits(std::vector<uint64_t>& sum, const HitsVector& hits);
+
+  // Renames the keys given to key_access(), created by the first key
+  std::optional<BasicIdRemapper<Addr>> remapper;
+  std::vector<Addr> renamed; // scratch of append_keys()
+
+  // Vector of operations used in ProjSequence to store memory operations.
+  // Only one of these is populated, see use_compact_ops().
+  std::vector<TimeOp> operations;
+  std::vector<CompactOp> compact_operations;
+
+  // While running upon a mapped op file, the mapped operations. Projections in this range of
+  // at most paged_ops_limit operations are copied into memory before being solved.
+  const void* mapped_begin = nullptr;
+  const void* mapped_end = nullptr;
+  size_t paged_ops_limit = 0;
+  ExternalIoStats* io_stats = nullptr;
+
+  // Set while a worker solves a projection copied into its memory. Such projections are
+  // solved without spawning tasks because the copy is freed when the worker returns.
+  inline static thread_local bool solving_paged = false;
+
+  // If the operations of num_reqs requests are stored as CompactOps
+  inline bool use_compact_ops(size_t num_reqs) const {
+    return config.op_encoding == COMPACT_OPS && num_reqs <= CompactOp::max_requests;
+  }
+
+  // The operations vector and base case kernels for the encoding OpT
+  template <typename OpT>
+  std::vector<OpT>& ops_of() {
+    if constexpr (std::is_same_v<OpT, TimeOp>) return operations;
+    else return compact_operations;
+  }
+  template <typename OpT>
+  const BaseCaseKernels<OpT>& kernels_of() const {
+    if constexpr (std::is_same_v<OpT, TimeOp>) return op_kernels;
+    else return compact_op_kernels;
+  }
+
+  // Set the base case kernels of the encoding OpT according to config
+  template <typename OpT>
+  void choose_kernels(BaseCaseKernels<OpT>& kernels) {
+    if (config.base_case_solver == FENWICK_TREE) {
+      kernels.narrow = kernels.wide = fenwick_base_case<OpT>;
+      return;
+    }
+    SimdLevel level = std::min(config.max_simd, detect_simd_level());
+    kernels.narrow = base_case_kernel<OpT>(level, true);
+    kernels.wide = base_case_kernel<OpT>(level, false);
+  }
+
+  // Per-worker histograms of the stack depths less than kIafLocalHits. Indexed by
+  // scheduler->worker_id() and merged into the hits vector once the projections are done,
+  // which leaves them zeroed for the next chunk. Deeper stack depths are sparse and are
+  // added to the hits vector atomically.
+  std::vector<HitsVector> local_hits;
+
+  /* Radix sort requests by (addr, access_number).
+   * If the widths of addr and access_number fit into 64 bits then the requests
+   * are packed into a single integer key. Otherwise, the two fields are sorted in turn.
+   */
+  static void radix_sort_requests(std::vector<request> &reqs);
 
   /* This converts the requests into the previous and next vectors
-   * Requests is copied, not modified.
+   * Requests may be reordered.
    * Precondition: requests must be properly populated.
    * Returns: number of unique ids in requests
    */
-  req_count_t populate_operations(std::vector<request> &req, std::vector<request> *living_req);
+  Time populate_operations(std::vector<request> &req, std::vector<request> *living_req);
+
+  /* Find the previous access to the id of each request by sorting the requests.
+   * Each request's previous access is the request before it in sorted order.
+   * last_access: set so that last_access[i] is the previous access of access_number i+1
+   * Returns: number of unique ids in requests
+   */
+  Time sort_find_last_access(std::vector<request> &reqs, std::vector<Time> &last_access,
+                             std::vector<request> *living_req);
+
+  /* Find the previous access to the id of each request without sorting. Requests are
+   * scanned in access order while an index of the last access to each id is maintained.
+   * Precondition: reqs[i].access_number == i+1
+   * last_access: set so that last_access[i] is the previous access of access_number i+1
+   * Returns: number of unique ids in requests
+   */
+  Time index_find_last_access(std::vector<request> &reqs, std::vector<Time> &last_access,
+                              std::vector<request> *living_req);
+
+  /* Write the compacted operations array directly from last_access, in parallel.
+   * No Null operations (besides the leading Null) are created.
+   */
+  template <typename OpT>
+  void emit_operations(const std::vector<Time> &last_access, std::vector<OpT>& ops);
 
   /* Helper function for update_hits_vector
    * Recursively (and in parallel) populates the distance vector if the
-   * projection is small enough, or calls itself with smaller projections otherwise.
+   * projection is small enough, or calls itself with kBranching smaller projections otherwise.
+   */
+  template <size_t kBranching, typename OpT>
+  void do_projections(HitsVector& distance_vector, ProjSequence<OpT> seq);
+
+  // Copy a projection of the mapped op file into memory and solve it there
+  template <size_t kBranching, typename OpT>
+  void do_paged_projections(HitsVector& distance_vector, ProjSequence<OpT> seq);
+
+  /*
+   * Run the recursion upon the num_ops operations at ops of num_reqs requests and add the
+   * stack depths to hits_vector, which must have space for every stack depth.
    */
-  void do_projections(std::vector<req_count_t>& distance_vector, ProjSequence seq);
+  template <typename OpT>
+  void run_projections(HitsVector& hits_vector, OpT* ops, size_t num_ops, Time num_reqs);
+
+  // Solve the op file described by header that is mapped at data
+  template <typename OpT>
+  void run_mapped_projections(HitsVector& hits_vector, void* data, const OpFileHeader& header,
+                              size_t memory_budget);
+
+  // do_projections instantiated for the fanout chosen at construction, for each encoding
+  template <typename OpT>
+  using ProjectionsFn = void (BasicIncrementAndFreeze::*)(HitsVector&, ProjSequence<OpT>);
+  ProjectionsFn<TimeOp> projections;
+  ProjectionsFn<CompactOp> compact_projections;
+
+  // The do_projections instantiation for the encoding OpT
+  template <typename OpT>
+  ProjectionsFn<OpT> projections_of() const {
+    if constexpr (std::is_same_v<OpT, TimeOp>) return projections;
+    else return compact_projections;
+  }
+
+  // Returns the do_projections instantiation for branching. Exits if there is none.
+  template <typename OpT>
+  static ProjectionsFn<OpT> projections_for(size_t branching);
+
+  // The do_projections instantiation of each fanout kIafBranchings[I]
+  template <typename OpT, size_t... I>
+  static std::array<ProjectionsFn<OpT>, sizeof...(I)> projections_table(std::index_sequence<I...>) {
+    return {&BasicIncrementAndFreeze::do_projections<kIafBranchings[I], OpT>...};
+  }
  
   /*
-   * Helper function for solving a projected sequence using the brute force algorithm
-   * This takes time O(n^2) but requires no recursion or other overheads. Thus, we can
-   * use it to solve larger ProjSequences.
+   * Helper function for solving a projected sequence without recursion.
+   * The brute force kernels take time O(n^2) but have no recursion or other overheads.
+   * Thus, we can use them to solve larger ProjSequences. The Fenwick tree kernel takes
+   * time O(n log n) and so can solve much larger ProjSequences.
+   * Stack depths are recorded in the local_hits of the calling worker if small enough.
    */
-  void do_base_case(std::vector<req_count_t>& distance_vector, ProjSequence seq);
+  template <typename OpT>
+  void do_base_case(HitsVector& distance_vector, ProjSequence<OpT> seq);
 
   /*
    * Update a hits vector with the stack depths of the memory requests found in reqs
    * reqs:        vector of memory requests to update the hits vector with
    * hits_vector: A hits vector indicates the number of requests that required a given memory amount
    */
-  void update_hits_vector(std::vector<request>& reqs, std::vector<req_count_t>& hits_vector,
+  void update_hits_vector(std::vector<request>& reqs, HitsVector& hits_vector,
                           std::vector<request> *living_req=nullptr);
+
+  // Integrate a hits vector into the success function, in place if Count is 64 bits
+  static SuccessVector integrate_hits(HitsVector& hits);
  public:
   // Logs a memory access to simulate. The order this function is called in matters.
-  void memory_access(req_count_t addr);
+  // Exits if addr does not fit in Addr. Processes the current segment if it fills.
+  void memory_access(uint64_t addr);
+
+  // Logs a memory access to each of num_blocks consecutive ids from first_addr. The extent is
+  // appended a piece at a time, processing the segment whenever it fills.
+  void extent_access(uint64_t first_addr, size_t num_blocks);
+
+  uint64_t get_max_id() const { return std::numeric_limits<Addr>::max(); }
+
+  // Logs a memory access to a 64 bit key, renamed to a dense id. Must not be mixed with
+  // memory_access() or extent_access(), whose ids would collide with the renamed keys.
+  void key_access(uint64_t key);
+  void key_batch_access(const uint64_t* keys, size_t num);
+
+  // Append the requests of num keys, renamed to dense ids, to reqs. Their access numbers
+  // continue from reqs.size() + 1. Large batches are renamed in parallel.
+  void append_keys(std::vector<request>& reqs, const uint64_t* keys, size_t num);
+
+  // The remapper of the keys given so far, or nullptr if there have been none
+  BasicIdRemapper<Addr>* get_id_remapper() { return remapper ? &*remapper : nullptr; }
+
+  // Append the requests of an extent of num_blocks ids from first_addr to reqs. Their access
+  // numbers continue from reqs.size() + 1.
+  void append_extent(std::vector<request>& reqs, uint64_t first_addr, size_t num_blocks) const {
+    const uint64_t max_id = std::numeric_limits<Addr>::max();
+    if (num_blocks > 0 && (num_blocks - 1 > max_id || first_addr > max_id - (num_blocks - 1)))
+      id_width_error(first_addr + num_blocks - 1, max_id);
+    size_t begin = reqs.size();
+    reqs.resize(begin + num_blocks);
+    extent_filler(reqs.data() + begin, first_addr, begin + 1, num_blocks);
+  }
   /* Returns the success function.
    * Does *a lot* of work.
    * When calling print_success_function, the answer is re-computed.
    */
   SuccessVector get_success_function();
 
+  /*
+   * Returns the success function of the requests whose operations were written to the op
+   * file at op_path by an ExternalOpBuilder. The op file is mapped and used as scratch space,
+   * so it is overwritten. The largest projections are partitioned within the mapping while
+   * those that fit in each worker's share of memory_budget are copied into memory.
+   * stats: if not null, incremented by the I/O of the recursion
+   * Exits if the op file cannot be read.
+   */
+  SuccessVector get_success_function(const std::string& op_path, size_t memory_budget,
+                                     ExternalIoStats* stats = nullptr);
+
   /*
    * Process a chunk of requests (called by IAF_Wrapper)
    * Return the new living requests and the success function
    */
   void process_chunk(ChunkInput &input);
 
-  IncrementAndFreeze() = default;
-  ~IncrementAndFreeze() = default;
+  // Sort requests by (addr, access_number) using the given engine
+  static void sort_requests(std::vector<request> &reqs, SortEngine engine);
+
+  // Returns if reqs[i].access_number == i+1 for every request
+  static bool in_access_order(const std::vector<request> &reqs);
+
+  // By default the config is loaded from the tuning profile named by $IAF_TUNING_PROFILE
+  BasicIncrementAndFreeze(IafConfig config = tuned_config());
+  ~BasicIncrementAndFreeze() = default;
 };
 
+// The widths that are instantiated. 32 bit Time permits up to CompactOp::max_requests requests
+// at once. 64 bit Counts hold the hits that BoundedIAF accumulates over many chunks, whose
+// chunk-local access numbers fit in 32 bits even when the ids do not.
+extern template class BasicIncrementAndFreeze<uint32_t, uint32_t, uint32_t>;
+extern template class BasicIncrementAndFreeze<uint32_t, uint32_t, uint64_t>;
+extern template class BasicIncrementAndFreeze<uint64_t, uint32_t, uint64_t>;
+extern template class BasicIncrementAndFreeze<uint64_t, uint64_t, uint64_t>;
+
+// IncrementAndFreeze of the default width, see req_count_t
+using IncrementAndFreeze = BasicIncrementAndFreeze<req_count_t, req_count_t, req_count_t>;
+
 #endif  // ONLINE_CACHE_SIMULATOR_INCREMENT_AND_FREEZE_H_
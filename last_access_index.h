@@ -0,0 +1,101 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef ONLINE_CACHE_SIMULATOR_LAST_ACCESS_INDEX_H_
+#define ONLINE_CACHE_SIMULATOR_LAST_ACCESS_INDEX_H_
+
+#include <cassert>     // for assert
+#include <cstddef>     // for size_t
+#include <cstdint>     // for uint64_t
+#include <vector>      // for vector
+
+#include "cache_sim.h" // for req_count_t
+
+// If the largest addr is at most kDenseUniverseFactor times the number of requests
+// then the last access of each addr is held in a directly indexed table.
+constexpr size_t kDenseUniverseFactor = 4;
+
+// Addresses are assigned to partitions in groups of this size so that a cache line
+// of a LastAccessTable is only written by a single partition.
+constexpr size_t kAddrGroupBits = 4;
+
+// The partition that handles addr, partitions own disjoint sets of addresses
+inline size_t addr_partition(uint64_t addr, size_t num_partitions) {
+  uint64_t group = (uint64_t)addr >> kAddrGroupBits;
+  return ((group * 0x9E3779B97F4A7C15ull) >> 32) % num_partitions;
+}
+
+// Last access of each addr stored in a table indexed by addr.
+// Shared by all partitions, each of which only touches its own addresses.
+// Time: the type of access numbers
+template <typename Time = req_count_t>
+class LastAccessTable {
+ private:
+  std::vector<Time>& table;
+ public:
+  LastAccessTable(std::vector<Time>& table) : table(table) {};
+
+  // Record access_num as the last access to addr and return the previous (or 0)
+  inline Time exchange(uint64_t addr, Time access_num) {
+    assert(addr < table.size());
+    Time prev = table[addr];
+    table[addr] = access_num;
+    return prev;
+  }
+};
+
+// Last access of each addr stored in an open addressing hash map with linear probing.
+// Each partition owns a private map so no synchronization is necessary.
+// Addr and Time: the types of addrs and access numbers
+template <typename Addr = req_count_t, typename Time = req_count_t>
+class LastAccessMap {
+ private:
+  struct Slot {
+    Addr addr;
+    Time last; // 0 indicates an empty slot
+  };
+  std::vector<Slot> slots;
+  size_t mask;
+  size_t shift; // fibonacci hashing keeps the top log2(capacity) bits of the product
+ public:
+  // max_keys: upper bound on the number of addresses inserted into the map
+  LastAccessMap(size_t max_keys) : shift(60) {
+    size_t capacity = 16;
+    while (capacity < 2 * max_keys) {
+      capacity *= 2;
+      --shift;
+    }
+    slots.resize(capacity, {0, 0});
+    mask = capacity - 1;
+  }
+
+  // Record access_num as the last access to addr and return the previous (or 0)
+  inline Time exchange(Addr addr, Time access_num) {
+    assert(access_num != 0);
+    size_t idx = ((uint64_t)addr * 0x9E3779B97F4A7C15ull) >> shift;
+    while (slots[idx].last != 0 && slots[idx].addr != addr)
+      idx = (idx + 1) & mask;
+
+    Time prev = slots[idx].last;
+    slots[idx] = {addr, access_num};
+    return prev;
+  }
+};
+
+#endif  // ONLINE_CACHE_SIMULATOR_LAST_ACCESS_INDEX_H_
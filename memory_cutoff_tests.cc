@@ -141,3 +141,21 @@ TEST(MemoryCutoffTests, CompareToIAF) {
       ASSERT_EQ(svec[j], truth[j]);
   }
 }
+
+TEST(MemoryCutoffTests, ChunkLocalTime) {
+  // 64 bit ids with 32 bit chunk-local access numbers agree with the default width
+  using ChunkTimeIAF = BasicBoundedIAF<uint64_t, uint32_t, uint64_t>;
+  static_assert(sizeof(BasicIncrementAndFreeze<uint64_t, uint32_t, uint64_t>::request) == 12);
+  ChunkTimeIAF chunk_time(512, 64);
+  BoundedIAF truth(512, 64);
+
+  std::mt19937_64 gen(42);
+  std::uniform_int_distribution<int> distribution(1,1000);
+  const uint64_t wide_base = (uint64_t)1 << 40;
+  for (int i = 0; i < 100000; i++) {
+    uint64_t num = distribution(gen);
+    chunk_time.memory_access(wide_base + num);
+    truth.memory_access(num);
+  }
+  ASSERT_EQ(chunk_time.get_success_function(), truth.get_success_function());
+}
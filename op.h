@@ -24,56 +24,57 @@
 #include <cstddef>     // for size_t
 #include <cstdint>     // for uint64_t, uint32_t, int64_t, int32_t
 #include <iostream>    // for operator<<, basic_ostream::operator<<, basic_o...
+#include <type_traits> // for make_signed_t
 #include <utility>     // for pair, move, swap
 #include <vector>      // for vector, vector<>::iterator
 
 #include "cache_sim.h"  // for CacheSim
-#include "iaf_params.h" // for kIafBranching
-
-#ifdef ADDR_BIT32
-typedef int32_t sign_req_count_t;
-constexpr size_t mask_bits = 31;
-#else
-typedef int64_t sign_req_count_t;
-constexpr size_t mask_bits = 63;
-#endif
 
 // Operation types and be Prefix, Postfix, or Null
 // Prefix and Postfix are encoded by a single bit at the beginning of _target
 // Null is encoded by an entirely zero _target variable
 enum OpType {Prefix=0, Postfix=1, Null=2};
 
-// An IAF operation
-// Due to design of Op, max number of requests to process at once is 2^mask_bits
-class Op {
+// An IAF operation whose target and full amount are each a Word, the type of access numbers.
+// Due to design of BasicOp, max number of requests to process at once is 2^mask_bits.
+// IncrementAndFreeze numbers longer traces in segments of at most max_requests.
+template <typename Word>
+class BasicOp {
+ public:
+  using Time = Word;
+  using SignedWord = std::make_signed_t<Word>;
+  static constexpr size_t mask_bits = sizeof(Word) * 8 - 1;
+
+  // Largest number of requests whose ops may use this encoding
+  static constexpr size_t max_requests = ((size_t)1 << mask_bits) - 1;
  private:
-  req_count_t _target = 0;              // Boundary of operation
+  Word _target = 0;                     // Boundary of operation
   static constexpr size_t inc_amnt = 1; // subrange Increment amount
-  sign_req_count_t full_amnt = 0;                // fullrange Increment amount
+  SignedWord full_amnt = 0;             // fullrange Increment amount
 
-  static constexpr req_count_t tmask = ~((req_count_t)1 << mask_bits);
-  static constexpr req_count_t ntmask = ~tmask;
-  void set_target(const req_count_t& new_target) {
+  static constexpr Word tmask = ~((Word)1 << mask_bits);
+  static constexpr Word ntmask = ~tmask;
+  void set_target(const Word& new_target) {
     assert(new_target == (new_target & tmask));
     _target &= ntmask;
     _target |= new_target;
   };
   inline void set_type(const OpType& t) {
     _target &= tmask;
-    _target |= ((sign_req_count_t)t << mask_bits);
+    _target |= ((Word)t << mask_bits);
   };
  public:
   // create an Prefix (if target is 0 -> becomes a Null op)
-  Op(req_count_t target, sign_req_count_t full_amnt)
+  BasicOp(Word target, SignedWord full_amnt)
       : full_amnt(full_amnt){set_type(Prefix); set_target(target);};
 
   // create a Postfix
-  Op(req_count_t target){set_type(Postfix); set_target(target);};
+  BasicOp(Word target){set_type(Postfix); set_target(target);};
 
   // Uninitialized. Used to parallelize making a vector of this without push_back
-  Op() {};
+  BasicOp() {};
 
-  friend std::ostream& operator<<(std::ostream& os, const Op& op) {
+  friend std::ostream& operator<<(std::ostream& os, const BasicOp& op) {
     switch (op.get_type()) {
       case Prefix: os << "Pr:0-" << op.get_target() << ".+" << op.full_amnt; break;
       case Postfix:  os << "Po:" << op.get_target() << "-Inf" << ".+" << op.full_amnt; break;
@@ -84,20 +85,25 @@ class Op {
   }
 
   inline void make_null() { _target = 0; }
-  inline void add_full(size_t oth_full_amnt) { full_amnt += oth_full_amnt; }
+  inline void add_full(SignedWord oth_full_amnt) { full_amnt += oth_full_amnt; }
 
   // returns if this operation will cross from right to left
-  inline bool move_to_scratch(req_count_t proj_start) const {
+  inline bool move_to_scratch(Word proj_start) const {
     return get_target() < proj_start && get_type() == Postfix;
   }
 
   // returns if this operation is the boundary prefix op
   // boundary operations target the end of the left partition and are Prefixes
-  inline bool is_boundary_op(req_count_t left_end) const {
+  inline bool is_boundary_op(Word left_end) const {
     return get_target() == left_end && get_type() == Prefix;
   }
 
-  inline size_t get_full_incr_to_left(req_count_t right_start) const {
+  // returns if this operation stays on the right side, unmodified except for its position,
+  // when partitioning at left_end. Boundary ops, crossing Postfixes, and Nulls all target at
+  // most left_end (Prefixes never target before left_end) so this is a single compare.
+  inline bool stays_right(Word left_end) const { return get_target() > left_end; }
+
+  inline size_t get_full_incr_to_left(Word right_start) const {
     // if a Prefix and target is in right then both full and inc affect
     // left side as a full
     if (get_type() == Prefix && get_target() >= right_start)
@@ -112,8 +118,21 @@ class Op {
     else return (OpType)(_target >> mask_bits);
   }
   inline bool is_null() const                   { return _target == 0; }
-  inline req_count_t get_target() const         { return _target & tmask; }
-  inline req_count_t get_inc_amnt() const       { return inc_amnt; }
-  inline sign_req_count_t get_full_amnt() const { return full_amnt; }
+  inline Word get_target() const                { return _target & tmask; }
+  inline Word get_inc_amnt() const              { return inc_amnt; }
+  inline SignedWord get_full_amnt() const       { return full_amnt; }
 };
+
+// Ops of a request count width. Permits up to 2^mask_bits requests.
+using Op = BasicOp<req_count_t>;
+
+// Ops of 64 bit access numbers, the widest encoding. Identical to Op unless ADDR_BIT32.
+using WideOp = BasicOp<uint64_t>;
+
+// Ops packed into a single 64 bit word with a 31 bit target and a 32 bit full amount.
+// Used instead of Op when there are at most CompactOp::max_requests requests, which
+// bounds both the targets and the full amounts. Identical to Op when ADDR_BIT32.
+using CompactOp = BasicOp<uint32_t>;
+static_assert(sizeof(CompactOp) == sizeof(uint64_t));
+
 #endif  // ONLINE_CACHE_SIMULATOR_OP_H_
@@ -22,7 +22,7 @@
 #include <utility>
 
 // perform a memory access and use the LRU_queue to update the success function
-void OSTCacheSim::memory_access(req_count_t addr) {
+void OSTCacheSim::memory_access(uint64_t addr) {
   uint64_t ts = access_number++;
 
   // attempt to find the addr in the OSTree
@@ -46,7 +46,7 @@ void OSTCacheSim::memory_access(req_count_t addr) {
 // return the rank of the page before updating the timestamp
 // assumes that a page with the old_ts exists in the LRU_queue
 uint64_t OSTCacheSim::move_front_queue(uint64_t old_ts, uint64_t new_ts) {
-  std::pair<uint64_t, req_count_t> found = LRU_queue.find(old_ts);
+  std::pair<uint64_t, uint64_t> found = LRU_queue.find(old_ts);
 
   LRU_queue.remove(found.first);
   LRU_queue.insert(new_ts, found.second);
@@ -56,7 +56,7 @@ uint64_t OSTCacheSim::move_front_queue(uint64_t old_ts, uint64_t new_ts) {
 // return the success function by starting at the back of the
 // page_hits vector and summing the elements to the front
 CacheSim::SuccessVector OSTCacheSim::get_success_function() {
-  req_count_t nhits = 0;
+  uint64_t nhits = 0;
 
   // update the memory usage of the OSTreeSim
   memory_usage = LRU_queue.get_weight() * sizeof(OSTree);
@@ -5,11 +5,13 @@ set -u
 # $1 - path to parda
 # $2 - directory where the traces are
 # $3 - number of threads to run
+# $4 - path to trace_convert (default: bazel-bin/trace_convert of this repository)
 
 parda=$(readlink -f $1)
 run_parda=$parda
 trace_dir=$2
 threads=$3
+trace_convert=$(readlink -f ${4:-$(dirname $0)/../bazel-bin/trace_convert})
 
 echo "Running Parda"
 echo "Traces directory:  $trace_dir"
@@ -28,6 +30,14 @@ mkdir $out_dir
 set -e
 cd -
 
+# PARDA reads text traces, so convert the binary traces written by dump_traces
+for name in uniform zipfian_0.1 zipfian_0.2 zipfian_0.4 zipfian_0.6 zipfian_0.8; do
+  if [ ! -f $trace_dir/$name.trace ] || [ $trace_dir/$name.iaftrace -nt $trace_dir/$name.trace ]; then
+    echo "Converting $name.iaftrace"
+    $trace_convert $trace_dir/$name.iaftrace $trace_dir/$name.trace
+  fi
+done
+
 lines=$(wc -l < $trace_dir/uniform.trace)
 bash partition_trace.sh $parda $trace_dir/uniform.trace $threads $lines
 
@@ -27,9 +27,8 @@
 #include <utility>      // for pair, move, swap
 #include <vector>       // for vector, vector<>::iterator
 #include <array>        // for array
-#include <cmath>        // for ceil
+#include <algorithm>    // for min, max
 
-#include "iaf_params.h" // for kIafBranching
 #include "op.h"         // for op
 #include "projection.h" // for ProjSequence
 
@@ -44,52 +43,229 @@ constexpr uint64_t ce_log2(uint64_t n) {
   return ans;
 }
 
+// Divides by a fixed divisor with a multiply and a shift instead of a hardware divide
+// (Lemire et al., "Faster Remainder by Direct Computation"). This is exact when both the
+// numerators and the divisor are below 2^32, otherwise a hardware divide is used.
+class FixedDivisor {
+ private:
+  uint64_t divisor;
+  uint64_t magic;
+  bool use_magic;
+ public:
+  // max_numerator: largest numerator that will be divided
+  FixedDivisor(uint64_t divisor, uint64_t max_numerator)
+      : divisor(divisor), magic(UINT64_MAX / divisor + 1),
+        use_magic(divisor > 1 && divisor <= UINT32_MAX && max_numerator <= UINT32_MAX) {}
+
+  inline uint64_t divide(uint64_t numerator) const {
+    if (use_magic) return ((__uint128_t)magic * numerator) >> 64;
+    return numerator / divisor;
+  }
+};
+
+// Per-thread bump arena of op blocks from which PartitionStates build their scratch stacks.
+// The PartitionStates alive on a thread are nested by the recursion, so each one releases
+// everything allocated since its creation when it is destroyed. The arena keeps its memory
+// for the lifetime of the thread, so after warming up the recursion never touches the heap.
+template <typename OpT>
+class ScratchArena {
+ public:
+  static constexpr size_t kBlockOps = 16;
+  static constexpr uint32_t kNoBlock = UINT32_MAX;
+ private:
+  std::vector<OpT> ops;        // kBlockOps ops per block
+  std::vector<uint32_t> next;  // the block that follows each block in its chain
+  uint32_t top = 0;            // blocks below top are in use
+ public:
+  // The arena of the calling thread
+  static ScratchArena& local() {
+    thread_local ScratchArena arena;
+    return arena;
+  }
+
+  uint32_t mark() const { return top; }
+
+  // Release every block allocated since mark() returned bottom
+  void release(uint32_t bottom) {
+    assert(bottom <= top);
+    top = bottom;
+  }
+
+  uint32_t alloc() {
+    if (top == next.size()) {
+      next.resize(std::max((size_t) 64, 2 * next.size()));
+      ops.resize(next.size() * kBlockOps);
+    }
+    next[top] = kNoBlock;
+    return top++;
+  }
+
+  inline OpT* block(uint32_t idx) { return &ops[idx * kBlockOps]; }
+  inline uint32_t& next_block(uint32_t idx) { return next[idx]; }
+};
+
 // State that is persisted between calls to partition() at a single node in recursion tree.
+// kBranching: fanout of the node, must be a power of 2
+// OpT:        the operation encoding, WideOp or CompactOp
+template <size_t kBranching, typename OpT>
 class PartitionState {
+  static_assert(kBranching >= 2 && (kBranching & (kBranching - 1)) == 0,
+                "kBranching must be a power of 2");
+  using Time = typename OpT::Time;
  private:
-  std::array<req_count_t, kIafBranching> incr_array{};
-  static constexpr size_t incr_tree_depth = ce_log2(kIafBranching);
+  // Partitions are of equal size except that the rightmost dist % num_parts are one larger.
+  // This is biased toward making right side projections larger which is good because they
+  // shrink while left gets bigger.
+  Time start;
+  size_t num_parts;
+  Time small_size;       // size of the leftmost partitions
+  size_t num_small;             // number of partitions of small_size
+  Time large_begin;      // offset from start of the first partition of small_size+1
+  FixedDivisor small_divisor;
+  FixedDivisor large_divisor;
+
+  // The increment tree counts, for each partition, the prior queries of partitions to its
+  // left. Each node is kIncrFanout wide and holds the prefix counts of its children, so a
+  // query reads one counter per level and an update adds to a suffix of one node per level.
+  static constexpr size_t kIncrFanoutBits = 4;
+  static constexpr size_t kIncrFanout = 1 << kIncrFanoutBits;
+  static constexpr size_t incr_levels = (ce_log2(kBranching) + kIncrFanoutBits - 1) / kIncrFanoutBits;
+  static constexpr size_t incr_level_nodes(size_t level) {
+    size_t child_bits = kIncrFanoutBits * (incr_levels - level);
+    return kBranching >> child_bits > 0 ? kBranching >> child_bits : 1;
+  }
+  static constexpr size_t incr_tree_size() {
+    size_t size = 0;
+    for (size_t level = 0; level < incr_levels; level++)
+      size += incr_level_nodes(level) * kIncrFanout;
+    return size;
+  }
+  alignas(64) std::array<Time, incr_tree_size()> incr_tree{};
+
+  // The scratch stacks of every partition are chains of blocks from the thread's ScratchArena.
+  // Emptied stacks return their blocks to a free list for reuse by this node.
+  // The Null at the end of each stack is not stored, only its full amount.
+  using Arena = ScratchArena<OpT>;
+  static constexpr size_t kScratchBlock = Arena::kBlockOps;
+  static constexpr uint32_t kNoBlock = Arena::kNoBlock;
+  struct ScratchStack {
+    uint32_t head = kNoBlock;
+    uint32_t tail = kNoBlock;
+    size_t size = 0;
+    typename OpT::SignedWord null_full = 0;
+  };
+  std::array<ScratchStack, kBranching-1> stacks;
+  Arena& arena;
+  const uint32_t arena_bottom;
+  uint32_t free_blocks = kNoBlock;
+
+  uint32_t alloc_block() {
+    if (free_blocks != kNoBlock) {
+      uint32_t block = free_blocks;
+      free_blocks = arena.next_block(block);
+      return block;
+    }
+    return arena.alloc();
+  }
 
  public:
-  const double div_factor;
-  int all_partitions_full_incr = 0;
-  std::array<std::vector<Op>, kIafBranching-1> scratch_spaces;
-  int merge_into_idx;
-  int cur_idx;
-  
-  PartitionState(double split, uint64_t num_ops) : 
-   div_factor(split), merge_into_idx(num_ops-1), cur_idx(merge_into_idx) {
-    for (auto& scratch : scratch_spaces)
-      scratch.emplace_back(); // Create an empty null op in each scratch_space
+  // Full amounts are bookkeeping that may wrap, so they are kept in the width of OpT
+  typename OpT::SignedWord all_partitions_full_incr = 0;
+  // Signed so that walking past the front of the ops is visible, and 64 bits because a
+  // segment or op file of 32 bit access numbers may hold more than 2^31 ops
+  int64_t merge_into_idx;
+  int64_t cur_idx;
+
+  // Partition the requests [start, end] whose projected sequence has num_ops operations.
+  // A node of fewer than kBranching * part_size requests is split into just enough
+  // partitions that each is at most part_size, rather than into kBranching tiny ones.
+  PartitionState(Time start, Time end, uint64_t num_ops, Time part_size)
+      : start(start),
+        num_parts(std::max((Time) 2,
+                           std::min((end - start + part_size) / part_size, (Time) kBranching))),
+        small_size((end - start + 1) / num_parts),
+        num_small(num_parts - (end - start + 1) % num_parts),
+        large_begin(num_small * small_size),
+        small_divisor(small_size, end - start),
+        large_divisor(small_size + 1, end - start),
+        arena(Arena::local()), arena_bottom(arena.mark()),
+        merge_into_idx(num_ops-1), cur_idx(merge_into_idx) {}
+
+  // States must be destroyed on the thread that created them, in reverse order of creation
+  ~PartitionState() { arena.release(arena_bottom); }
+  PartitionState(const PartitionState&) = delete;
+  PartitionState& operator=(const PartitionState&) = delete;
+
+  size_t num_partitions() const { return num_parts; }
+
+  // First request of partition idx
+  Time partition_start(size_t idx) const {
+    if (idx <= num_small) return start + idx * small_size;
+    return start + large_begin + (idx - num_small) * (small_size + 1);
   }
 
-  // Debugging function for printing the incr_array
-  void print_incr_array() {
-    // print tree
-    for (auto elm : incr_array)
-      std::cout << elm << " ";
-    std::cout << std::endl;
+  // The partition that contains request target
+  inline size_t partition_of(Time target) const {
+    assert(target >= start);
+    Time offset = target - start;
+    if (offset < large_begin) return small_divisor.divide(offset);
+    return num_small + large_divisor.divide(offset - large_begin);
+  }
+
+  // Number of ops in scratch stack idx, excluding its Null
+  size_t scratch_size(size_t idx) const { return stacks[idx].size; }
+
+  // Full amount of the Null at the end of scratch stack idx
+  typename OpT::SignedWord& scratch_null_full(size_t idx) { return stacks[idx].null_full; }
+
+  // Push op onto scratch stack idx, before its Null
+  inline void push_scratch(size_t idx, const OpT& op) {
+    ScratchStack& stack = stacks[idx];
+    size_t pos = stack.size % kScratchBlock;
+    if (pos == 0) {
+      uint32_t block = alloc_block();
+      if (stack.head == kNoBlock) stack.head = block;
+      else arena.next_block(stack.tail) = block;
+      stack.tail = block;
+    }
+    arena.block(stack.tail)[pos] = op;
+    ++stack.size;
+  }
+
+  // Call func upon each op of scratch stack idx in the order they were pushed, then empty it
+  template <typename Func>
+  void drain_scratch(size_t idx, Func func) {
+    ScratchStack& stack = stacks[idx];
+    uint32_t block = stack.head;
+    for (size_t i = 0; i < stack.size; i += kScratchBlock) {
+      size_t block_ops = std::min(kScratchBlock, stack.size - i);
+      OpT* ops = arena.block(block);
+      for (size_t j = 0; j < block_ops; j++)
+        func(ops[j]);
+      block = arena.next_block(block);
+    }
+    if (stack.head != kNoBlock) {
+      arena.next_block(stack.tail) = free_blocks;
+      free_blocks = stack.head;
+    }
+    stack = ScratchStack();
   }
 
-  // Update path to partition_target+1 to represent an increment by 1 in range
-  // [partition_target+1, kIafBranching)
-  // We represent this tree with the trick that root index = 0
-  // left child = cur*2 + 1, right child = cur*2 + 2
-  inline req_count_t qry_and_upd_partition_incr(req_count_t partition_target) {
-    assert(partition_target < kIafBranching-1);
-    size_t depth_shift = incr_tree_depth - 1;
-    size_t idx = 0;
-    req_count_t sum = 0;
-
-    for (size_t depth = 0; depth < incr_tree_depth; depth++) {
-      assert(idx < kIafBranching);
-      // if 0 go left, if 1 go right
-      size_t leftright = (partition_target & (1 << depth_shift)) >> depth_shift;
-      incr_array[idx] += leftright ^ 1;                      // if go left add to tree node value
-      sum += incr_array[idx] & ((req_count_t)0 - leftright); // if go right add to sum
-
-      idx = 2*idx + leftright + 1;
-      --depth_shift;
+  // Record an increment by 1 in range [partition_target+1, kBranching) and return the number
+  // of such increments already recorded that cover partition_target.
+  inline Time qry_and_upd_partition_incr(size_t partition_target) {
+    assert(partition_target < kBranching-1);
+    Time sum = 0;
+    Time* level_counts = incr_tree.data();
+    for (size_t level = 0; level < incr_levels; level++) {
+      size_t shift = kIncrFanoutBits * (incr_levels - 1 - level);
+      size_t node  = partition_target >> (shift + kIncrFanoutBits);
+      size_t digit = (partition_target >> shift) & (kIncrFanout - 1);
+      Time* counts = level_counts + node * kIncrFanout;
+      sum += counts[digit];
+      for (size_t child = 0; child < kIncrFanout; child++)
+        counts[child] += child > digit;
+      level_counts += incr_level_nodes(level) * kIncrFanout;
     }
     return sum;
   }
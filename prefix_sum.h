@@ -0,0 +1,74 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef ONLINE_CACHE_SIMULATOR_PREFIX_SUM_H_
+#define ONLINE_CACHE_SIMULATOR_PREFIX_SUM_H_
+
+#include <omp.h>
+
+#include <cstddef>     // for size_t
+#include <vector>      // for vector
+
+// Below this many elements the prefix sum is performed by a single thread
+constexpr size_t kPrefixSumSerialCutoff = 1 << 16;
+
+/*
+ * Inclusive prefix sum so that out[i] = in[0] + ... + in[i], summed in the type of out, which
+ * may be wider than in. in and out may be the same array. Each thread sums a contiguous block
+ * of in, the block sums are scanned, and then each thread writes the prefix sum of its block
+ * offset by the sum of the blocks before it.
+ */
+template <typename In, typename T>
+void parallel_prefix_sum(const In* in, T* out, size_t n) {
+  if (n < kPrefixSumSerialCutoff || omp_get_max_threads() == 1) {
+    T running = 0;
+    for (size_t i = 0; i < n; i++) {
+      running += in[i];
+      out[i] = running;
+    }
+    return;
+  }
+
+  std::vector<T> block_sum(omp_get_max_threads() + 1);
+#pragma omp parallel
+  {
+    const size_t num_threads = omp_get_num_threads();
+    const size_t tid = omp_get_thread_num();
+    const size_t begin = n * tid / num_threads;
+    const size_t end = n * (tid + 1) / num_threads;
+
+    T sum = 0;
+    for (size_t i = begin; i < end; i++)
+      sum += in[i];
+    block_sum[tid + 1] = sum;
+
+#pragma omp barrier
+#pragma omp single
+    for (size_t t = 1; t <= num_threads; t++)
+      block_sum[t] += block_sum[t - 1];
+
+    T running = block_sum[tid];
+    for (size_t i = begin; i < end; i++) {
+      running += in[i];
+      out[i] = running;
+    }
+  }
+}
+
+#endif  // ONLINE_CACHE_SIMULATOR_PREFIX_SUM_H_
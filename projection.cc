@@ -19,13 +19,54 @@
 
 #include "projection.h"
 
-void ProjSequence::partition(ProjSequence& left, ProjSequence& right, req_count_t split_off_idx, PartitionState& state) {
+#include <algorithm> // for copy_backward, fill, min
+#include <cstring>   // for memchr
+#include <tuple>     // for make_tuple
+#include <utility>   // for index_sequence
+
+// Runs of ops that stay on the right side are usually short, so the first
+// kPartitionScalarOps are classified one at a time. Longer runs are then classified
+// kPartitionTile ops at once.
+constexpr size_t kPartitionScalarOps = 8;
+constexpr size_t kPartitionTile = 64;
+
+// Count the consecutive ops ending at ops[cur] and walking towards the front that stay on
+// the right side. The targets of each tile of ops are gathered into a column and compared
+// against left_end together so the classification compiles to SIMD compares, the first
+// op that does not stay is then found with memchr. ops[0] is a Null so the run ends there.
+template <typename OpT>
+static inline size_t stay_run(const OpT* ops, size_t cur, typename OpT::Time left_end) {
+  size_t run = 0;
+  for (; run < kPartitionScalarOps; run++)
+    if (!ops[cur - run].stays_right(left_end)) return run;
+
+  while (run <= cur) {
+    size_t len = std::min(kPartitionTile, cur + 1 - run);
+    const OpT* tile = ops + cur - run - (len - 1);
+    typename OpT::Time targets[kPartitionTile];
+    uint8_t stays[kPartitionTile];
+    for (size_t i = 0; i < len; i++)
+      targets[i] = tile[len - 1 - i].get_target();
+    for (size_t i = 0; i < len; i++)
+      stays[i] = targets[i] > left_end;
+
+    const void* first_leaves = memchr(stays, 0, len);
+    if (first_leaves != nullptr)
+      return run + ((const uint8_t*) first_leaves - stays);
+    run += len;
+  }
+  return run;
+}
+
+template <typename OpT>
+template <size_t kBranching>
+void ProjSequence<OpT>::partition(ProjSequence& left, ProjSequence& right,
+                                  Time split_off_idx,
+                                  PartitionState<kBranching, OpT>& state) {
   // pull relevant stuff out of PartitionState
-  const double div_factor        = state.div_factor;
-  int& all_partitions_full_incr  = state.all_partitions_full_incr;
-  auto& partition_scratch_spaces = state.scratch_spaces;
-  int& merge_into_idx            = state.merge_into_idx;
-  int& cur_idx                   = state.cur_idx;
+  auto& all_partitions_full_incr = state.all_partitions_full_incr;
+  int64_t& merge_into_idx        = state.merge_into_idx;
+  int64_t& cur_idx               = state.cur_idx;
 
 
   // std::cout << "Performing partition upon projected sequence" << std::endl;
@@ -43,11 +84,33 @@ void ProjSequence::partition(ProjSequence& left, ProjSequence& right, req_count_
   assert(op_seq[0].is_null());
 
   // Where we merge operations that remain on the right side
-  // use ints for this and cur_idx because underflow is good and tells us things
+  // use signed ints for this and cur_idx because underflow is good and tells us things
 
   // loop through all the operations on the right side
   for (; cur_idx >= 0; cur_idx--) {
-    Op& op = op_seq[cur_idx];
+    // Ops that stay on the right side are processed as a run. Their increments to the left
+    // are summed and, if ops have been merged away, the run is shifted up to merge_into_idx
+    // in a single copy. This matches processing each of them below.
+    size_t run = stay_run(&op_seq[0], cur_idx, left.end);
+    if (run > 0) {
+      auto run_begin = op_seq + (cur_idx + 1 - run);
+      auto run_end   = op_seq + (cur_idx + 1);
+      for (auto it = run_begin; it != run_end; ++it)
+        all_partitions_full_incr += it->get_full_incr_to_left(right.start);
+
+      if (merge_into_idx != cur_idx) {
+        assert(op_seq[merge_into_idx].is_null());
+        op_seq[cur_idx].add_full(op_seq[merge_into_idx].get_full_amnt());
+        std::copy_backward(run_begin, run_end, op_seq + (merge_into_idx + 1));
+        // the slots vacated by the run become no impact operations
+        std::fill(run_begin, op_seq + (std::min(cur_idx, merge_into_idx - (int64_t) run) + 1),
+                  OpT());
+      }
+      cur_idx -= run;
+      merge_into_idx -= run;
+    }
+
+    OpT& op = op_seq[cur_idx];
 
     assert(op.get_type() != Prefix || op.get_target() >= left.end);
 
@@ -55,7 +118,7 @@ void ProjSequence::partition(ProjSequence& left, ProjSequence& right, req_count_
       // std::cout << op << " is a BOUNDARY OP" << std::endl;
       // we merge this op with the next left op (also need to add inc amount to full)
       // The previous OP is the end of the scratch space
-      Op& prev_op = op_seq[cur_idx-1];
+      OpT& prev_op = op_seq[cur_idx-1];
       prev_op.add_full(op.get_full_amnt() + op.get_inc_amnt());
 
       // AND merge this op with merge_into_idx
@@ -68,7 +131,7 @@ void ProjSequence::partition(ProjSequence& left, ProjSequence& right, req_count_
         op_seq[merge_into_idx].add_full(op.get_full_amnt());
 
         // make this boundary_op have no_impact
-        op = Op();
+        op = OpT();
       }
 
       // done processing
@@ -80,27 +143,26 @@ void ProjSequence::partition(ProjSequence& left, ProjSequence& right, req_count_
       // std::cout << "MOVING " << op << " left!" << std::endl;
 
       // 1. Identify the partition this Postfix is targeting (inverting the parition map)
-      req_count_t partition_target = ceil((op.get_target() - (start-1)) / div_factor) - 1;
+      size_t partition_target = state.partition_of(op.get_target());
       assert(partition_target < split_off_idx);
 
       // 2. Place this Postfix in the appropriate scratch space.
       //    the null at the end of the scratch_stack gives a sum of the full increments
       //    already applied to this partition
-      std::vector<Op>& scratch_stack = partition_scratch_spaces[partition_target];
-      assert(scratch_stack.back().is_null());
-      
+      auto& stack_null_full = state.scratch_null_full(partition_target);
+
       // query for Postfix increments that are full increments in this partition and incr them
-      req_count_t incrs = state.qry_and_upd_partition_incr(partition_target);
-      req_count_t stack_full_incr_sum = scratch_stack.back().get_full_amnt();
-      scratch_stack.back() = op;
-      scratch_stack.back().add_full(incrs + all_partitions_full_incr - stack_full_incr_sum);
+      Time incrs = state.qry_and_upd_partition_incr(partition_target);
+      Time stack_full_incr_sum = stack_null_full;
+      OpT moved = op;
+      moved.add_full(incrs + all_partitions_full_incr - stack_full_incr_sum);
+      state.push_scratch(partition_target, moved);
 
       // 3. Add to all_partitions_full_incr
       all_partitions_full_incr += op.get_full_amnt();
 
-      // 4. save the amount of full we've already added to target_partition in a new Null op
-      scratch_stack.emplace_back(); // add a new empty Null to end of scratch stack
-      scratch_stack.back().add_full(incrs + all_partitions_full_incr); // set the full
+      // 4. save the amount of full we've already added to target_partition in a new Null
+      stack_null_full = incrs + all_partitions_full_incr;
 
       // 5. At this point, we've projected op into [placement, last). 
       //    Now let's fix the value in last (split_off_idx).
@@ -108,7 +170,7 @@ void ProjSequence::partition(ProjSequence& left, ProjSequence& right, req_count_
       if (cur_idx != merge_into_idx) {
         // merge this operation with merge_into_idx and make this op no impact
         op_seq[merge_into_idx].add_full(op.get_full_amnt() + op.get_inc_amnt());
-        op = Op(); // make empty
+        op = OpT(); // make empty
       } else {
         // make this operation null and add incr amount to full
         op.add_full(op.get_inc_amnt());
@@ -122,10 +184,10 @@ void ProjSequence::partition(ProjSequence& left, ProjSequence& right, req_count_
 
       if (merge_into_idx != cur_idx) {
         // merge current op into merge idx op
-        req_count_t full = op_seq[merge_into_idx].get_full_amnt();
+        Time full = op_seq[merge_into_idx].get_full_amnt();
         op.add_full(full);
         op_seq[merge_into_idx] = op;
-        op = Op(); // set where op used to be to a no_impact operation
+        op = OpT(); // set where op used to be to a no_impact operation
       }
       // if moved operation is not null then we need to decr merge_into_idx
       if (!op_seq[merge_into_idx].is_null()) merge_into_idx--;
@@ -176,30 +238,25 @@ void ProjSequence::partition(ProjSequence& left, ProjSequence& right, req_count_
   // Merge in scratch_stack for leftmost partition scratch spaces
   // Iterate through these from front to back while walking the merge_into_idx
   // to the left.
-  std::vector<Op>& scratch_stack = partition_scratch_spaces[split_off_idx - 1];
-  assert(scratch_stack.size() > 0 && scratch_stack.back().is_null());
-  assert(merge_into_idx - cur_idx >= (int) scratch_stack.size());
-  for (req_count_t i = 0; i < scratch_stack.size() - 1; i++) {
-    --merge_into_idx;
-    // std::cout << op_seq[merge_into_idx] << " <- " << scratch_stack[i] << std::endl;
-    op_seq[merge_into_idx] = scratch_stack[i];
-  }
-  // The last op in the scratch_stack is a Null that defines the amount we should
+  size_t scratch_idx = split_off_idx - 1;
+  assert(merge_into_idx - cur_idx >= (int64_t) state.scratch_size(scratch_idx) + 1);
+  // The Null at the end of the scratch stack defines the amount we should
   // add to all_partitions_full_incr to define an additional full increment
-  Op& back = scratch_stack.back();
-  req_count_t incrs_to_end = state.qry_and_upd_partition_incr(split_off_idx - 1);
+  auto null_full = state.scratch_null_full(scratch_idx);
+  state.drain_scratch(scratch_idx, [&](const OpT& scratch_op) {
+    op_seq[--merge_into_idx] = scratch_op;
+  });
+  Time incrs_to_end = state.qry_and_upd_partition_incr(scratch_idx);
   merge_into_idx--;
-  op_seq[merge_into_idx].add_full(all_partitions_full_incr + incrs_to_end - back.get_full_amnt());
-  scratch_stack.clear();
+  op_seq[merge_into_idx].add_full(all_partitions_full_incr + incrs_to_end - null_full);
 
 #ifndef NDEBUG
   // Calculate the number of Postfixes that are unresolved
   // Ensure there is enough space for them in future partitions
-  int unresolved_postfixes = 0;
+  int64_t unresolved_postfixes = 0;
   // std::cout << "split_off_idx = " << split_off_idx << std::endl;
-  for (req_count_t i = 0; i < split_off_idx - 1; i++) {
-    // std::cout << "Size of " << i << " = " << partition_scratch_spaces[i].size() << std::endl;
-    unresolved_postfixes += partition_scratch_spaces[i].size() - 1;
+  for (Time i = 0; i < split_off_idx - 1; i++) {
+    unresolved_postfixes += state.scratch_size(i);
   }
   // assert there will be enough space for these unresolved postfixes
   // in the future
@@ -213,3 +270,14 @@ void ProjSequence::partition(ProjSequence& left, ProjSequence& right, req_count_
   // std::cout << "LEFT:  " << left << std::endl;
   // std::cout << "RIGHT: " << right << std::endl << std::endl;
 }
+
+// Instantiate every fanout in kIafBranchings for both operation encodings. Taking the address
+// of each fanout's partition in these exported tables instantiates it in this file.
+template <typename OpT, size_t... I>
+constexpr auto partitions_of(std::index_sequence<I...>) {
+  return std::make_tuple(&ProjSequence<OpT>::template partition<kIafBranchings[I]>...);
+}
+extern const auto kWidePartitions =
+    partitions_of<WideOp>(std::make_index_sequence<kNumIafBranchings>());
+extern const auto kCompactPartitions =
+    partitions_of<CompactOp>(std::make_index_sequence<kNumIafBranchings>());
@@ -33,32 +33,39 @@
 #include "op.h"         // for op
 #include "partition.h"  // for partitionstate
 
-class PartitionState;
+template <size_t kBranching, typename OpT> class PartitionState;
 
-// A sequence of operators defined by a projection
+// A sequence of operators defined by a projection. OpT is WideOp or CompactOp, whose Time
+// gives the width of request numbers.
+template <typename OpT>
 class ProjSequence {
  public:
-  std::vector<Op>::iterator op_seq; // iterator to beginning of operations sequence
-  req_count_t num_ops;                   // number of operations in this projection
+  using Time = typename OpT::Time;
+
+  OpT* op_seq;                           // beginning of operations sequence
+  Time num_ops;                          // number of operations in this projection
 
   // Request sequence range
-  req_count_t start;
-  req_count_t end;
+  Time start;
+  Time end;
   
   // Initialize an empty projection with bounds (to be filled in by partition)
-  ProjSequence(req_count_t start, req_count_t end) : start(start), end(end) {};
+  ProjSequence(Time start, Time end) : start(start), end(end) {};
 
   // Init a projection with bounds and iterators
-  ProjSequence(req_count_t start, req_count_t end, std::vector<Op>::iterator op_seq, req_count_t num_ops) : 
+  ProjSequence(Time start, Time end, OpT* op_seq, Time num_ops) :
    op_seq(op_seq), num_ops(num_ops), start(start), end(end) {};
 
-  void partition(ProjSequence& left, ProjSequence& right, req_count_t split_off_idx, PartitionState& state);
+  // Instantiated for each fanout in kIafBranchings
+  template <size_t kBranching>
+  void partition(ProjSequence& left, ProjSequence& right, Time split_off_idx,
+                 PartitionState<kBranching, OpT>& state);
 
   friend std::ostream& operator<<(std::ostream& os, const ProjSequence& seq) {
     os << "start = " << seq.start << " end = " << seq.end << std::endl;
     os << "num_ops = " << seq.num_ops << std::endl;
     os << "Operations: ";
-    for (req_count_t i = 0; i < seq.num_ops; i++)
+    for (Time i = 0; i < seq.num_ops; i++)
       os << seq.op_seq[i] << " ";
     return os;
   }
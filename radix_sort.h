@@ -0,0 +1,109 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef ONLINE_CACHE_SIMULATOR_RADIX_SORT_H_
+#define ONLINE_CACHE_SIMULATOR_RADIX_SORT_H_
+
+#include <omp.h>
+
+#include <array>       // for array
+#include <cstddef>     // for size_t
+#include <cstdint>     // for uint64_t
+#include <utility>     // for swap
+#include <vector>      // for vector
+
+constexpr size_t kRadixBits    = 11;               // bits sorted per pass
+constexpr size_t kRadixBuckets = 1 << kRadixBits;  // histogram size per pass
+constexpr size_t kRadixMask    = kRadixBuckets - 1;
+
+// Below this many elements a pass is performed by a single thread
+constexpr size_t kRadixSerialCutoff = 1 << 16;
+
+// number of bits needed to represent val
+inline size_t num_bits(uint64_t val) { return val == 0 ? 0 : 64 - __builtin_clzll(val); }
+
+/*
+ * One stable counting sort pass of src into dst upon digit(elm) in [0, kRadixBuckets).
+ * Each thread counts the digits of a contiguous block of src and then scatters that
+ * same block, so the output remains stable.
+ * Returns false, and leaves dst untouched, if every element shares the same digit.
+ * If bucket_starts is given then bucket_starts[d] is set to the index of the first
+ * element with digit d and bucket_starts[kRadixBuckets] = n.
+ */
+template <typename T, typename DigitFn>
+bool radix_pass(const T* src, T* dst, size_t n, DigitFn digit, size_t* bucket_starts=nullptr) {
+  using Histogram = std::array<size_t, kRadixBuckets>;
+  std::vector<Histogram> hists(omp_get_max_threads());
+  bool skip = false;
+
+#pragma omp parallel if (n >= kRadixSerialCutoff)
+  {
+    const size_t num_threads = omp_get_num_threads();
+    const size_t tid = omp_get_thread_num();
+    const size_t begin = n * tid / num_threads;
+    const size_t end = n * (tid + 1) / num_threads;
+
+    Histogram& hist = hists[tid];
+    hist.fill(0);
+    for (size_t i = begin; i < end; i++)
+      ++hist[digit(src[i])];
+
+#pragma omp barrier
+#pragma omp single
+    {
+      // exclusive scan in digit-major, thread-minor order
+      size_t offset = 0;
+      for (size_t d = 0; d < kRadixBuckets; d++) {
+        if (bucket_starts != nullptr) bucket_starts[d] = offset;
+        const size_t bucket_start = offset;
+        for (size_t t = 0; t < num_threads; t++) {
+          size_t count = hists[t][d];
+          hists[t][d] = offset;
+          offset += count;
+        }
+        if (offset - bucket_start == n) skip = true;
+      }
+      if (bucket_starts != nullptr) bucket_starts[kRadixBuckets] = n;
+    } // implicit barrier
+
+    if (!skip) {
+      for (size_t i = begin; i < end; i++)
+        dst[hist[digit(src[i])]++] = src[i];
+    }
+  }
+  return !skip;
+}
+
+/*
+ * Least significant digit radix sort of data upon bits [low_bit, high_bit) of key(elm).
+ * Bits below low_bit are not examined so data should already be sorted by them.
+ * scratch is used as the double buffer and is resized to match data.
+ */
+template <typename T, typename KeyFn>
+void parallel_radix_sort(std::vector<T>& data, std::vector<T>& scratch, size_t low_bit,
+                         size_t high_bit, KeyFn key) {
+  scratch.resize(data.size());
+  for (size_t shift = low_bit; shift < high_bit; shift += kRadixBits) {
+    auto digit = [&](const T& elm) { return (key(elm) >> shift) & kRadixMask; };
+    if (radix_pass(data.data(), scratch.data(), data.size(), digit))
+      std::swap(data, scratch);
+  }
+}
+
+#endif  // ONLINE_CACHE_SIMULATOR_RADIX_SORT_H_
@@ -20,6 +20,10 @@
 #ifndef ONLINE_CACHE_SIMULATOR_SIM_FACTORY_H_
 #define ONLINE_CACHE_SIMULATOR_SIM_FACTORY_H_
 
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
 #include "container_cache_sim.h"
 #include "bounded_iaf.h"
 #include "increment_and_freeze.h"
@@ -33,20 +37,73 @@ enum CacheSimType {
   BOUND_IAF,
 };
 
-std::unique_ptr<CacheSim> new_simulator(CacheSimType sim_enum, size_t min_chunk = 65536,
-                                        size_t mem_limit = 0) {
+// What is known of a trace before it is simulated, such as from the footer of a binary trace
+struct TraceBounds {
+  uint64_t max_addr;     // largest id
+  uint64_t num_accesses;
+  bool keys = false;     // fed through key_batch_access(), which renames them to dense ids
+};
+
+/*
+ * Returns a new simulator of the given type. IAF and BOUND_IAF are instantiated with 32 bit ids
+ * and access numbers if bounds shows that they fit, which halves the memory of their requests
+ * and operations, and with 64 bit ones otherwise. IAF numbers traces of more than
+ * CompactOp::max_requests accesses in segments, so it keeps 32 bits while the ids leave room.
+ * If bounds is null their ids have the default width of req_count_t. BOUND_IAF numbers the
+ * requests of each chunk from 1, so it keeps 32 bit access numbers beside 64 bit ids whenever
+ * mem_limit or bounds keep its chunks small enough. If bounds->keys is set the addresses are
+ * renamed to dense ids, which BOUND_IAF recycles so that they fit in 32 bits whenever its
+ * access numbers do.
+ */
+inline std::unique_ptr<CacheSim> new_simulator(CacheSimType sim_enum, size_t min_chunk = 65536,
+                                               size_t mem_limit = 0,
+                                               IafConfig config = tuned_config(),
+                                               const TraceBounds* bounds = nullptr) {
+  if (mem_limit == 0) mem_limit = BoundedIAF::unlimited_cache;
+  // Renamed keys are numbered densely from 0, so there are fewer ids than accesses
+  uint64_t max_id = UINT64_MAX;
+  if (bounds != nullptr) {
+    max_id = bounds->max_addr;
+    if (bounds->keys && bounds->num_accesses > 0)
+      max_id = std::min(max_id, bounds->num_accesses - 1);
+  }
+  const bool narrow_ids = max_id <= UINT32_MAX;
   switch (sim_enum) {
     case OS_TREE:
       return std::make_unique<OSTCacheSim>();
     case OS_SET:
       return std::make_unique<ContainerCacheSim>();
     case IAF:
-      return std::make_unique<IncrementAndFreeze>();
-    case BOUND_IAF:
-      if (mem_limit != 0)
-        return std::make_unique<BoundedIAF>(min_chunk, mem_limit);
-      else
-        return std::make_unique<BoundedIAF>(min_chunk);
+      if (bounds == nullptr)
+        return std::make_unique<IncrementAndFreeze>(config);
+      // Longer traces are numbered in segments, whose living requests must leave room
+      if (narrow_ids && (bounds->num_accesses <= CompactOp::max_requests
+                         || max_id < CompactOp::max_requests / 2))
+        return std::make_unique<BasicIncrementAndFreeze<uint32_t, uint32_t, uint32_t>>(config);
+      return std::make_unique<BasicIncrementAndFreeze<uint64_t, uint64_t, uint64_t>>(config);
+    case BOUND_IAF: {
+      // Access numbers are local to a chunk, so they fit in 32 bits whenever the chunks are
+      // bounded by the cache size or the number of ids, whatever the width of the ids
+      uint64_t num_ids = UINT64_MAX;
+      if (bounds != nullptr)
+        num_ids = max_id < bounds->num_accesses ? max_id + 1 : bounds->num_accesses;
+      const bool narrow_time = BoundedIAF::max_chunk_size(min_chunk, mem_limit, num_ids)
+                               <= CompactOp::max_requests;
+      if (!narrow_time && bounds == nullptr)
+        return std::make_unique<BoundedIAF>(min_chunk, mem_limit, config);
+      if (!narrow_time)
+        return std::make_unique<BasicBoundedIAF<uint64_t, uint64_t, uint64_t>>(
+            min_chunk, mem_limit, config);
+      if (bounds == nullptr)
+        return std::make_unique<BasicBoundedIAF<req_count_t, uint32_t, uint64_t>>(
+            min_chunk, mem_limit, config);
+      // Renamed keys are recycled after every chunk, so their ids stay below the chunk size
+      if (narrow_ids || bounds->keys)
+        return std::make_unique<BasicBoundedIAF<uint32_t, uint32_t, uint64_t>>(
+            min_chunk, mem_limit, config);
+      return std::make_unique<BasicBoundedIAF<uint64_t, uint32_t, uint64_t>>(
+          min_chunk, mem_limit, config);
+    }
     default:
       std::cerr << "ERROR: Unrecognized sim_enum!" << std::endl;
       exit(EXIT_FAILURE);
@@ -30,6 +30,7 @@
 #include "absl/time/clock.h"
 #include "sim_factory.h"
 #include "params.h"
+#include "workload.h"
 
 struct SimResult {
   CacheSim::SuccessVector success;
@@ -133,46 +134,6 @@ SimResult simulate_on_seq(CacheSim &sim, std::vector<uint64_t>& seq) {
   return {succ, duration};
 }
 
-std::vector<uint64_t> generate_zipf(uint64_t seed, double alpha) {
-  // std::ofstream zipf_hist("Zipf_hist_" + std::to_string(alpha) + ".data");
-  std::mt19937_64 rand(seed); // create random number generator
-  std::vector<double> freq_vec;
-  freq_vec.reserve(kIdUniverseSize);
-  // generate the divisor
-  double divisor = 0;
-  for (uint64_t i = 1; i < kIdUniverseSize + 1; i++) {
-    divisor += 1 / pow(i, alpha);
-  }
-
-  // now for each id calculate it's normalized frequency
-  for (uint64_t i = 1; i < kIdUniverseSize + 1; i++)
-    freq_vec.push_back((1 / pow(i, alpha)) / divisor);
-
-  // now push to sequence vector based upon frequency
-  std::vector<uint64_t> seq_vec;
-  seq_vec.reserve(kAccesses);
-  for (uint64_t i = 0; i < kIdUniverseSize; i++) {
-    uint64_t num_items = round(freq_vec[i] * kAccesses);
-    // zipf_hist << i << ":" << num_items << std::endl;
-    for (uint64_t j = 0; j < num_items && seq_vec.size() < kAccesses; j++)
-      seq_vec.push_back(i);
-  }
-
-  // if we have too few accesses make up for it by adding more to most common
-  if (seq_vec.size() < kAccesses) {
-    uint64_t num_needed = kAccesses - seq_vec.size();
-    for (uint64_t i = 0; i < num_needed; i++)
-      seq_vec.push_back(i % kIdUniverseSize);
-  }
-
-  seq_vec.resize(kAccesses);
-
-  // shuffle the sequence vector
-  std::shuffle(seq_vec.begin(), seq_vec.end(), rand);
-  // std::cout << "Zipfian sequence memory impact: " << seq_vec.size() * sizeof(uint64_t)/1024/1024 << "MiB" << std::endl;
-  return seq_vec;
-}
-
 constexpr char ArgumentsString[] = "Arguments: out_file, sim, workload, [zipf_alpha]\n\
 out_file:   The file in which to place the success function.\n\
 sim:        Which simulator to use. One of: 'OS_TREE', 'OS_SET', 'IAF', 'BOUND_IAF', 'K_LIM_IAF'\n\
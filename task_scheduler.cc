@@ -0,0 +1,174 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "task_scheduler.h"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <utility>
+
+void TaskScheduler::parallel_for(size_t n, size_t min_block,
+                                 const std::function<void(size_t begin, size_t end)>& body) {
+  const size_t num_blocks = std::max((size_t)1, std::min(num_workers(), n / min_block));
+  if (num_blocks == 1) {
+    body(0, n);
+    return;
+  }
+  run([&]() {
+    for (size_t b = 0; b < num_blocks; b++)
+      spawn([&body, n, num_blocks, b]() {
+        body(n * b / num_blocks, n * (b + 1) / num_blocks);
+      });
+  });
+}
+
+void OmpScheduler::run(const Task& root) {
+#pragma omp parallel
+#pragma omp single
+  root();
+}
+
+void OmpScheduler::spawn(Task task) {
+#pragma omp task firstprivate(task)
+  task();
+}
+
+size_t OmpScheduler::num_workers() const { return omp_get_max_threads(); }
+
+size_t OmpScheduler::worker_id() const { return omp_get_thread_num(); }
+
+namespace {
+// Failed attempts to find a task before an idle worker sleeps between attempts
+constexpr size_t kStealAttempts = 1024;
+
+// The pool and worker index of the calling thread, if it belongs to a pool
+thread_local const WorkStealingPool* cur_pool = nullptr;
+thread_local size_t cur_worker = 0;
+}  // namespace
+
+WorkStealingPool::WorkStealingPool(size_t num_workers)
+    : workers(new Worker[std::max(num_workers, (size_t)1)]),
+      team_size(std::max(num_workers, (size_t)1)) {
+  for (size_t id = 1; id < team_size; id++)
+    helpers.emplace_back(&WorkStealingPool::helper_loop, this, id);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lk(run_lock);
+    shutdown = true;
+  }
+  run_cv.notify_all();
+  for (auto& helper : helpers)
+    helper.join();
+}
+
+size_t WorkStealingPool::worker_id() const { return cur_pool == this ? cur_worker : 0; }
+
+void WorkStealingPool::spawn(Task task) {
+  assert(cur_pool == this);
+  pending.fetch_add(1, std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lk(workers[cur_worker].lock);
+  workers[cur_worker].tasks.push_back(std::move(task));
+}
+
+bool WorkStealingPool::try_pop(size_t id, Task& task) {
+  std::lock_guard<std::mutex> lk(workers[id].lock);
+  if (workers[id].tasks.empty()) return false;
+  task = std::move(workers[id].tasks.back());
+  workers[id].tasks.pop_back();
+  return true;
+}
+
+bool WorkStealingPool::try_steal(size_t id, Task& task) {
+  for (size_t i = 1; i < team_size; i++) {
+    Worker& victim = workers[(id + i) % team_size];
+    std::lock_guard<std::mutex> lk(victim.lock);
+    if (victim.tasks.empty()) continue;
+    task = std::move(victim.tasks.front());
+    victim.tasks.pop_front();
+    return true;
+  }
+  return false;
+}
+
+// Run tasks until every task of the current run() has completed
+void WorkStealingPool::work_until_done(size_t id) {
+  Task task;
+  size_t failed_attempts = 0;
+  while (pending.load(std::memory_order_acquire) != 0) {
+    if (try_pop(id, task) || try_steal(id, task)) {
+      task();
+      task = nullptr;
+      pending.fetch_sub(1, std::memory_order_release);
+      failed_attempts = 0;
+    }
+    else if (++failed_attempts < kStealAttempts)
+      std::this_thread::yield();
+    else
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+}
+
+void WorkStealingPool::helper_loop(size_t id) {
+  cur_pool = this;
+  cur_worker = id;
+  uint64_t seen_epoch = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lk(run_lock);
+      run_cv.wait(lk, [&]() { return shutdown || epoch != seen_epoch; });
+      if (shutdown) return;
+      seen_epoch = epoch;
+    }
+    work_until_done(id);
+  }
+}
+
+void WorkStealingPool::run(const Task& root) {
+  assert(cur_pool == nullptr); // run() may not be nested
+  cur_pool = this;
+  cur_worker = 0;
+
+  pending.store(1, std::memory_order_relaxed); // the root
+  if (team_size > 1) {
+    {
+      std::lock_guard<std::mutex> lk(run_lock);
+      ++epoch;
+    }
+    run_cv.notify_all();
+  }
+  root();
+  pending.fetch_sub(1, std::memory_order_release);
+  work_until_done(0);
+  cur_pool = nullptr;
+}
+
+std::unique_ptr<TaskScheduler> new_scheduler(Scheduler type) {
+  switch (type) {
+    case WORK_STEALING:
+      return std::make_unique<WorkStealingPool>(omp_get_max_threads());
+    case OPENMP_TASKS:
+    default:
+      return std::make_unique<OmpScheduler>();
+  }
+}
@@ -0,0 +1,129 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef ONLINE_CACHE_SIMULATOR_TASK_SCHEDULER_H_
+#define ONLINE_CACHE_SIMULATOR_TASK_SCHEDULER_H_
+
+#include <atomic>             // for atomic
+#include <condition_variable> // for condition_variable
+#include <cstddef>            // for size_t
+#include <cstdint>            // for uint64_t
+#include <deque>              // for deque
+#include <functional>         // for function
+#include <memory>             // for unique_ptr
+#include <mutex>              // for mutex
+#include <thread>             // for thread
+#include <vector>             // for vector
+
+#include "iaf_params.h"       // for Scheduler
+
+using Task = std::function<void()>;
+
+// Runs the tasks of the IncrementAndFreeze recursion upon a team of workers
+class TaskScheduler {
+ public:
+  virtual ~TaskScheduler() = default;
+
+  // Run root and every task it spawns (transitively). Returns once all have completed.
+  virtual void run(const Task& root) = 0;
+
+  // Create a task that may be run by any worker. Only valid within run().
+  virtual void spawn(Task task) = 0;
+
+  // Number of workers that may run tasks
+  virtual size_t num_workers() const = 0;
+
+  // Index in [0, num_workers()) of the calling worker. Only valid within run().
+  virtual size_t worker_id() const = 0;
+
+  // Run body(begin, end) upon blocks of at least min_block that together cover [0, n)
+  void parallel_for(size_t n, size_t min_block,
+                    const std::function<void(size_t begin, size_t end)>& body);
+};
+
+// OpenMP tasks within a parallel region that is opened by each call to run()
+class OmpScheduler : public TaskScheduler {
+ public:
+  void run(const Task& root);
+  void spawn(Task task);
+  size_t num_workers() const;
+  size_t worker_id() const;
+};
+
+/*
+ * A team of threads that lives as long as the scheduler. Each worker owns a deque of tasks:
+ * it pushes and pops at the back while idle workers steal from the front. Between calls
+ * to run() the helper threads sleep. The thread that calls run() acts as worker 0.
+ */
+class WorkStealingPool : public TaskScheduler {
+ private:
+  struct Worker {
+    std::mutex lock;
+    std::deque<Task> tasks;
+  };
+  std::unique_ptr<Worker[]> workers;
+  size_t team_size;
+  std::vector<std::thread> helpers;
+
+  std::atomic<size_t> pending{0}; // tasks spawned but not yet completed
+
+  std::mutex run_lock;
+  std::condition_variable run_cv;
+  uint64_t epoch = 0;             // incremented by each call to run()
+  bool shutdown = false;
+
+  bool try_pop(size_t id, Task& task);
+  bool try_steal(size_t id, Task& task);
+  void work_until_done(size_t id);
+  void helper_loop(size_t id);
+ public:
+  void run(const Task& root);
+  void spawn(Task task);
+  size_t num_workers() const { return team_size; };
+  size_t worker_id() const;
+
+  // num_workers: size of the team including the thread that calls run()
+  WorkStealingPool(size_t num_workers);
+  ~WorkStealingPool();
+};
+
+// Construct the scheduler of the given type with omp_get_max_threads() workers
+std::unique_ptr<TaskScheduler> new_scheduler(Scheduler type);
+
+// Owns a TaskScheduler. A copy constructs a new scheduler of the same type so that
+// copies of a simulator never share workers.
+class SchedulerHandle {
+ private:
+  Scheduler type;
+  std::unique_ptr<TaskScheduler> sched;
+ public:
+  SchedulerHandle(Scheduler type) : type(type), sched(new_scheduler(type)) {};
+  SchedulerHandle(const SchedulerHandle& oth) : SchedulerHandle(oth.type) {};
+  SchedulerHandle& operator=(const SchedulerHandle& oth) {
+    type = oth.type;
+    sched = new_scheduler(type);
+    return *this;
+  }
+  SchedulerHandle(SchedulerHandle&&) = default;
+  SchedulerHandle& operator=(SchedulerHandle&&) = default;
+
+  TaskScheduler* operator->() const { return sched.get(); }
+};
+
+#endif  // ONLINE_CACHE_SIMULATOR_TASK_SCHEDULER_H_
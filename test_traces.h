@@ -0,0 +1,54 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef ONLINE_CACHE_SIMULATOR_TEST_TRACES_H_
+#define ONLINE_CACHE_SIMULATOR_TEST_TRACES_H_
+
+#include <cstddef>      // for size_t
+#include <cstdint>      // for uint64_t
+#include <random>       // for mt19937_64
+#include <vector>       // for vector
+
+#include "cache_sim.h"  // for CacheSim, req_count_t
+
+// Traces shared by the tests of several components
+
+// Generate a trace of num_accesses where most accesses target a small hot set
+inline std::vector<req_count_t> skewed_trace(size_t num_accesses, req_count_t universe,
+                                             uint64_t seed) {
+  std::mt19937_64 gen(seed);
+  std::vector<req_count_t> trace;
+  trace.reserve(num_accesses);
+  for (size_t i = 0; i < num_accesses; i++) {
+    req_count_t addr = gen() % universe;
+    if (gen() % 4 != 0) addr %= universe / 16 + 1;
+    trace.push_back(addr);
+  }
+  return trace;
+}
+
+// Feed trace to sim and return its success function
+inline CacheSim::SuccessVector run_trace(CacheSim& sim, const std::vector<req_count_t>& trace) {
+  for (auto addr : trace)
+    sim.memory_access(addr);
+  return sim.get_success_function();
+}
+
+#endif  // ONLINE_CACHE_SIMULATOR_TEST_TRACES_H_
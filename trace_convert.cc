@@ -0,0 +1,101 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Converts traces between the text format, one address per line, and the binary format
+
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cache_sim.h"
+#include "trace_format.h"
+
+constexpr char ArgumentsString[] = "Arguments: input output\n\
+input:  A text trace with one address per line, or a binary trace.\n\
+output: Where to write the input in the other format.";
+
+// Write the addresses of a text trace to a binary trace
+int text_to_binary(const std::string& in_path, const std::string& out_path) {
+  std::ifstream in(in_path);
+  if (!in.is_open()) {
+    std::cerr << "ERROR: Could not open " << in_path << std::endl;
+    return EXIT_FAILURE;
+  }
+  TraceWriter writer(out_path);
+  uint64_t addr;
+  while (in >> addr)
+    writer.append(addr);
+  if (!in.eof()) {
+    std::cerr << "ERROR: " << in_path << " is not a trace of one address per line" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!writer.close()) {
+    std::cerr << "ERROR: Could not write " << out_path << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+// Write the addresses of a binary trace one per line
+int binary_to_text(const std::string& in_path, const std::string& out_path) {
+  TraceReader reader;
+  reader.open(in_path);
+  FILE* out = fopen(out_path.c_str(), "w");
+  if (out == nullptr) {
+    std::cerr << "ERROR: Could not open " << out_path << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::vector<uint64_t> addrs(kTraceBlockAccesses);
+  std::vector<char> text(kTraceBlockAccesses * 21);
+  bool ok = true;
+  for (size_t b = 0; b < reader.get_num_blocks(); b++) {
+    if (!reader.decode_block(b, addrs.data())) {
+      fclose(out);
+      std::cerr << "ERROR: " << in_path << " is not a well formed binary trace" << std::endl;
+      return EXIT_FAILURE;
+    }
+    char* pos = text.data();
+    for (size_t i = 0; i < reader.block_accesses(b); i++) {
+      pos = std::to_chars(pos, text.data() + text.size(), addrs[i]).ptr;
+      *pos++ = '\n';
+    }
+    ok = ok && fwrite(text.data(), 1, pos - text.data(), out) == (size_t)(pos - text.data());
+  }
+  ok = (fclose(out) == 0) && ok;
+  if (!ok) {
+    std::cerr << "ERROR: Could not write " << out_path << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    std::cerr << "ERROR: Incorrect number of arguments!" << std::endl;
+    std::cerr << ArgumentsString << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (is_binary_trace(argv[1]))
+    return binary_to_text(argv[1], argv[2]);
+  return text_to_binary(argv[1], argv[2]);
+}
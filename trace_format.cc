@@ -0,0 +1,303 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "trace_format.h"
+
+#include <fcntl.h>
+#include <omp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+
+// Blocks decoded in parallel by replay() per thread before they are fed to the simulator
+constexpr size_t kReplayBlocksPerThread = 4;
+
+void release_pages(const void* data, size_t begin, size_t end) {
+  static const size_t page = sysconf(_SC_PAGESIZE);
+  begin = (begin + page - 1) / page * page;
+  end = end / page * page;
+  if (begin < end) madvise((char*) data + begin, end - begin, MADV_DONTNEED);
+}
+
+const void* map_file(const std::string& path, size_t& size) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return nullptr;
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+    ::close(fd);
+    return nullptr;
+  }
+  size = file_stat.st_size;
+  void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) return nullptr;
+  madvise(map, size, MADV_SEQUENTIAL);
+  return map;
+}
+
+TraceWriter::TraceWriter(const std::string& path)
+    : block(kTraceBlockAccesses * kMaxVarintBytes) {
+  fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  ok = fd >= 0;
+}
+
+TraceWriter::~TraceWriter() {
+  if (fd >= 0) close();
+}
+
+bool TraceWriter::write_bytes(const void* data, size_t len) {
+  const char* ptr = (const char*) data;
+  while (ok && len > 0) {
+    ssize_t written = write(fd, ptr, len);
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) ok = false;
+    else {
+      ptr += written;
+      len -= written;
+      offset += written;
+    }
+  }
+  return ok;
+}
+
+bool TraceWriter::flush_block() {
+  if (block_accesses == 0) return ok;
+  index.push_back({offset, block_accesses});
+  write_bytes(block.data(), block_bytes);
+  block_bytes = 0;
+  block_accesses = 0;
+  prev = 0;
+  return ok;
+}
+
+void TraceWriter::append(uint64_t addr) {
+  uint8_t* end = encode_trace_addr(addr, prev, block.data() + block_bytes);
+  block_bytes = end - block.data();
+  prev = addr;
+  max_addr = std::max(max_addr, addr);
+  ++num_accesses;
+  if (++block_accesses == kTraceBlockAccesses) flush_block();
+}
+
+bool TraceWriter::close() {
+  if (fd < 0) return false;
+  flush_block();
+  TraceFooter footer;
+  footer.num_blocks = index.size();
+  footer.num_accesses = num_accesses;
+  footer.index_offset = offset;
+  footer.max_addr = max_addr;
+  write_bytes(index.data(), index.size() * sizeof(TraceBlockEntry));
+  write_bytes(&footer, sizeof(footer));
+  ok = (::close(fd) == 0) && ok;
+  fd = -1;
+  return ok;
+}
+
+TraceReader::~TraceReader() {
+  if (data != nullptr) munmap((void*) data, size);
+}
+
+bool TraceReader::open(const std::string& path) {
+  data = (const uint8_t*) map_file(path, size);
+  if (data == nullptr || size < sizeof(TraceFooter)) return false;
+
+  TraceFooter footer;
+  memcpy(&footer, data + size - sizeof(footer), sizeof(footer));
+  const size_t index_end = size - sizeof(footer);
+  if (footer.magic != kTraceMagic || footer.index_offset > index_end
+      || footer.num_blocks != (index_end - footer.index_offset) / sizeof(TraceBlockEntry))
+    return false;
+
+  index.resize(footer.num_blocks);
+  memcpy(index.data(), data + footer.index_offset, footer.num_blocks * sizeof(TraceBlockEntry));
+  first_access.resize(footer.num_blocks + 1);
+  for (size_t b = 0; b < footer.num_blocks; b++) {
+    // blocks lie in order, so each ends where the next begins
+    if (index[b].offset > footer.index_offset || index[b].num_accesses > kTraceBlockAccesses
+        || (b > 0 && index[b].offset < index[b - 1].offset))
+      return false;
+    first_access[b + 1] = first_access[b] + index[b].num_accesses;
+  }
+  num_accesses = first_access[footer.num_blocks];
+  max_addr = footer.max_addr;
+  data_bytes = footer.index_offset;
+  return num_accesses == footer.num_accesses;
+}
+
+bool TraceReader::decode_block(size_t block, uint64_t* out) const {
+  const uint8_t* in = data + index[block].offset;
+  const uint8_t* end = data + block_end(block);
+  uint64_t prev = 0;
+  for (uint64_t i = 0; i < index[block].num_accesses; i++) {
+    uint64_t zigzag = 0;
+    for (size_t shift = 0;; shift += 7) {
+      if (in == end || shift >= 7 * kMaxVarintBytes) return false;
+      uint8_t byte = *in++;
+      zigzag |= (uint64_t)(byte & 0x7f) << shift;
+      if (byte < 0x80) break;
+    }
+    prev += (zigzag >> 1) ^ -(zigzag & 1);
+    out[i] = prev;
+  }
+  return true;
+}
+
+bool TraceReader::decode_all(std::vector<uint64_t>& out) const {
+  out.resize(num_accesses);
+  bool ok = true;
+#pragma omp parallel for schedule(dynamic) reduction(&&:ok)
+  for (size_t b = 0; b < index.size(); b++)
+    ok = decode_block(b, out.data() + first_access[b]) && ok;
+  return ok;
+}
+
+bool TraceReader::replay(CacheSim& sim, bool keys) const {
+  if (!keys && max_addr > sim.get_max_id()) return false;
+  const size_t window = kReplayBlocksPerThread * omp_get_max_threads();
+  std::vector<uint64_t> addrs(window * kTraceBlockAccesses);
+  for (size_t first = 0; first < index.size(); first += window) {
+    const size_t last = std::min(first + window, index.size());
+    bool ok = true;
+#pragma omp parallel for schedule(dynamic) reduction(&&:ok)
+    for (size_t b = first; b < last; b++)
+      ok = decode_block(b, addrs.data() + first_access[b] - first_access[first]) && ok;
+    if (!ok) return false;
+
+    feed_trace(sim, addrs.data(), first_access[last] - first_access[first], keys);
+    release_pages(data, index[first].offset, last < index.size() ? index[last].offset : size);
+  }
+  return true;
+}
+
+TextTraceReader::~TextTraceReader() {
+  if (data != nullptr) munmap((void*) data, size);
+}
+
+bool TextTraceReader::open(const std::string& path) {
+  data = (const char*) map_file(path, size);
+  if (data != nullptr) return true;
+
+  // an empty trace cannot be mapped but holds no addresses
+  struct stat file_stat;
+  size = 0;
+  return stat(path.c_str(), &file_stat) == 0 && file_stat.st_size == 0;
+}
+
+bool TextTraceReader::replay(CacheSim& sim, bool keys) {
+  TextStreamParser parser(keys ? UINT64_MAX : sim.get_max_id());
+  std::vector<uint64_t> addrs;
+  bool ok = true;
+  for (size_t begin = 0; ok && begin < size; begin += kReleaseBytes) {
+    const size_t len = std::min(kReleaseBytes, size - begin);
+    ok = parser.parse(data + begin, len, addrs);
+    if (begin + len == size) ok = ok && parser.finish(addrs);
+    feed_trace(sim, addrs.data(), addrs.size(), keys);
+    num_accesses += addrs.size();
+    addrs.clear();
+    release_pages(data, begin, begin + len);
+  }
+  error_line = parser.get_error_line();
+  return ok;
+}
+
+bool TraceStreamDecoder::decode(const uint8_t* in, size_t len, std::vector<uint64_t>& out) {
+  const uint8_t* start = in;
+  const uint8_t* end = in + len;
+  while (in < end) {
+    if (block_left == 0) {
+      // start the next non-empty block, which must begin here
+      while (block < reader.get_num_blocks() && reader.block_accesses(block) == 0) ++block;
+      if (done()) return true;
+      if (reader.block_entry(block).offset != consumed + (in - start)) return false;
+      block_left = reader.block_accesses(block);
+      prev = 0;
+    }
+    for (; in < end && block_left > 0; ++in) {
+      zigzag |= (uint64_t)(*in & 0x7f) << shift;
+      if (*in >= 0x80) {
+        shift += 7;
+        if (shift >= 7 * kMaxVarintBytes) return false;
+        continue;
+      }
+      prev += (zigzag >> 1) ^ -(zigzag & 1);
+      out.push_back(prev);
+      zigzag = 0;
+      shift = 0;
+      if (--block_left == 0) ++block;
+    }
+  }
+  consumed += len;
+  return true;
+}
+
+bool TextStreamParser::parse_addr(const char* begin, const char* end,
+                                  std::vector<uint64_t>& out) {
+  uint64_t addr;
+  auto [next, err] = std::from_chars(begin, end, addr);
+  if (err != std::errc() || next != end || addr > max_addr) {
+    error_line = line;
+    return false;
+  }
+  out.push_back(addr);
+  return true;
+}
+
+bool TextStreamParser::parse(const char* in, size_t len, std::vector<uint64_t>& out) {
+  const char* end = in + len;
+  const char* pos = in;
+  if (!carry.empty()) {
+    while (pos < end && !is_trace_space(*pos)) carry.push_back(*pos++);
+    if (pos == end) return true;
+    if (!parse_addr(carry.data(), carry.data() + carry.size(), out)) return false;
+    carry.clear();
+  }
+  while (pos < end) {
+    if (is_trace_space(*pos)) {
+      line += *pos++ == '\n';
+      continue;
+    }
+    const char* addr_end = pos;
+    while (addr_end < end && !is_trace_space(*addr_end)) ++addr_end;
+    if (addr_end == end) {
+      carry.assign(pos, end);
+      return true;
+    }
+    if (!parse_addr(pos, addr_end, out)) return false;
+    pos = addr_end;
+  }
+  return true;
+}
+
+bool TextStreamParser::finish(std::vector<uint64_t>& out) {
+  if (carry.empty()) return true;
+  bool ok = parse_addr(carry.data(), carry.data() + carry.size(), out);
+  carry.clear();
+  return ok;
+}
+
+bool is_binary_trace(const std::string& path) {
+  TraceReader reader;
+  return reader.open(path);
+}
@@ -0,0 +1,248 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef ONLINE_CACHE_SIMULATOR_TRACE_FORMAT_H_
+#define ONLINE_CACHE_SIMULATOR_TRACE_FORMAT_H_
+
+#include <cstddef>     // for size_t
+#include <cstdint>     // for uint64_t, uint8_t
+#include <string>      // for string
+#include <vector>      // for vector
+
+#include "cache_sim.h" // for CacheSim, req_count_t
+
+/*
+ * Binary trace format
+ * A trace is a sequence of blocks of up to kTraceBlockAccesses addresses followed by an index.
+ * Within a block every address is stored as the zigzag encoded difference from the previous
+ * address (the first from 0) in a LEB128 varint. Blocks are therefore independent and may be
+ * decoded in parallel.
+ * The index holds a TraceBlockEntry for every block followed by a TraceFooter, which ends the
+ * file so that it is found from the file size.
+ */
+constexpr uint64_t kTraceMagic = 0x0001'4543'4152'5446; // "FTRACE" and the format version
+constexpr size_t kTraceBlockAccesses = 1 << 16;
+constexpr char kTraceExtension[] = ".iaftrace";
+
+struct TraceBlockEntry {
+  uint64_t offset;       // of the first byte of the block
+  uint64_t num_accesses; // in the block
+};
+
+struct TraceFooter {
+  uint64_t num_blocks;
+  uint64_t num_accesses;
+  uint64_t index_offset; // of the first TraceBlockEntry
+  uint64_t max_addr;     // largest address, so readers may choose the width of their ids
+  uint64_t magic = kTraceMagic;
+};
+
+// Largest number of bytes of an encoded address
+constexpr size_t kMaxVarintBytes = 10;
+
+// Append the encoding of addr, whose predecessor in the block is prev, to out
+inline uint8_t* encode_trace_addr(uint64_t addr, uint64_t prev, uint8_t* out) {
+  int64_t delta = (int64_t)(addr - prev);
+  uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+  while (zigzag >= 0x80) {
+    *out++ = (uint8_t)zigzag | 0x80;
+    zigzag >>= 7;
+  }
+  *out++ = (uint8_t)zigzag;
+  return out;
+}
+
+// Feed num addresses to sim in order, through key_batch_access() if keys is set so that sim
+// renames them to dense ids, and through memory_access() otherwise
+inline void feed_trace(CacheSim& sim, const uint64_t* addrs, size_t num, bool keys) {
+  if (keys) return sim.key_batch_access(addrs, num);
+  for (size_t i = 0; i < num; i++)
+    sim.memory_access(addrs[i]);
+}
+
+// Writes a binary trace. Addresses are buffered a block at a time.
+class TraceWriter {
+ private:
+  int fd;
+  uint64_t offset = 0;
+  uint64_t num_accesses = 0;
+  uint64_t max_addr = 0;
+  uint64_t prev = 0;
+  std::vector<uint8_t> block;
+  size_t block_bytes = 0;
+  size_t block_accesses = 0;
+  std::vector<TraceBlockEntry> index;
+  bool ok;
+
+  bool write_bytes(const void* data, size_t len);
+  bool flush_block();
+ public:
+  // Create or truncate the trace at path
+  TraceWriter(const std::string& path);
+  ~TraceWriter();
+  TraceWriter(const TraceWriter&) = delete;
+  TraceWriter& operator=(const TraceWriter&) = delete;
+
+  // If the trace was opened and every write so far succeeded
+  bool good() const { return ok; }
+
+  void append(uint64_t addr);
+
+  // Write the last block and the index. Returns false if any write failed.
+  bool close();
+};
+
+// Reads a binary trace through a read only mapping
+class TraceReader {
+ private:
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+  std::vector<TraceBlockEntry> index;
+  std::vector<uint64_t> first_access; // number of accesses before each block
+  uint64_t num_accesses = 0;
+  uint64_t max_addr = 0;
+  uint64_t data_bytes = 0;            // of the blocks, which precede the index
+
+  // Offset just past the bytes of block
+  uint64_t block_end(size_t block) const {
+    return block + 1 < index.size() ? index[block + 1].offset : data_bytes;
+  }
+ public:
+  TraceReader() = default;
+  ~TraceReader();
+  TraceReader(const TraceReader&) = delete;
+  TraceReader& operator=(const TraceReader&) = delete;
+
+  // Map the trace at path and read its index. Returns false if it is not a binary trace.
+  bool open(const std::string& path);
+
+  size_t get_num_blocks() const { return index.size(); }
+  uint64_t get_num_accesses() const { return num_accesses; }
+
+  // Largest address of the trace
+  uint64_t get_max_addr() const { return max_addr; }
+  uint64_t block_accesses(size_t block) const { return index[block].num_accesses; }
+  const TraceBlockEntry& block_entry(size_t block) const { return index[block]; }
+  uint64_t get_data_bytes() const { return data_bytes; }
+
+  // Decode the addresses of block into out, which must have space for block_accesses(block).
+  // Returns false if the block does not hold that many addresses.
+  bool decode_block(size_t block, uint64_t* out) const;
+
+  // Decode every address into out, decoding blocks in parallel. Returns false if a block is
+  // malformed.
+  bool decode_all(std::vector<uint64_t>& out) const;
+
+  // Feed every address to sim in order, as keys if keys is set, see feed_trace(). Each window
+  // of blocks is decoded in parallel and then fed to sim outside of any parallel region, so sim
+  // may use every thread. Pages of the trace are released once fed so memory does not grow
+  // with the trace. Returns false, feeding nothing, if the trace holds an address above
+  // sim.get_max_id() that is not a key, or at the first window with a malformed block.
+  bool replay(CacheSim& sim, bool keys = false) const;
+};
+
+// Decodes a binary trace from its bytes, which may arrive in pieces of any size
+class TraceStreamDecoder {
+ private:
+  const TraceReader& reader; // supplies the index
+  size_t block = 0;
+  uint64_t block_left = 0;   // accesses of the current block yet to be decoded
+  uint64_t consumed = 0;     // bytes of the file decoded so far
+  uint64_t prev = 0;
+  uint64_t zigzag = 0;       // bits of a varint split between pieces
+  size_t shift = 0;
+ public:
+  TraceStreamDecoder(const TraceReader& reader) : reader(reader) {};
+
+  // Decode the next len bytes of the file, appending their addresses to out. Bytes after the
+  // last block are ignored. Returns false if the blocks do not lie where the index says.
+  bool decode(const uint8_t* in, size_t len, std::vector<uint64_t>& out);
+
+  // If every block has been decoded
+  bool done() const { return block == reader.get_num_blocks(); }
+};
+
+// Returns if c separates the addresses of a text trace
+inline bool is_trace_space(char c) { return c == '\n' || c == ' ' || c == '\r' || c == '\t'; }
+
+// Parses a text trace from its bytes, which may arrive in pieces of any size
+class TextStreamParser {
+ private:
+  const uint64_t max_addr;
+  std::string carry; // address split between pieces
+  uint64_t line = 1;
+  uint64_t error_line = 0;
+
+  bool parse_addr(const char* begin, const char* end, std::vector<uint64_t>& out);
+ public:
+  // Accept addresses of at most max_addr
+  TextStreamParser(uint64_t max_addr = UINT64_MAX) : max_addr(max_addr) {};
+
+  // Parse the next len bytes, appending their addresses to out. Returns false at the first
+  // line that is not an address, or holds an address above max_addr.
+  bool parse(const char* in, size_t len, std::vector<uint64_t>& out);
+
+  // Parse an address that ends the trace without a newline
+  bool finish(std::vector<uint64_t>& out);
+
+  // Line of the first malformed address, or 0 if there is none
+  uint64_t get_error_line() const { return error_line; }
+};
+
+// Reads a text trace, one address per line, through a read only mapping
+class TextTraceReader {
+ private:
+  const char* data = nullptr;
+  size_t size = 0;
+  uint64_t num_accesses = 0;
+  uint64_t error_line = 0;
+ public:
+  TextTraceReader() = default;
+  ~TextTraceReader();
+  TextTraceReader(const TextTraceReader&) = delete;
+  TextTraceReader& operator=(const TextTraceReader&) = delete;
+
+  // Map the trace at path. Returns false if it could not be read.
+  bool open(const std::string& path);
+
+  // Number of addresses fed by replay()
+  uint64_t get_num_accesses() const { return num_accesses; }
+
+  // Line of the first malformed address, or 0 if there is none
+  uint64_t get_error_line() const { return error_line; }
+
+  // Feed every address to sim in order, as keys if keys is set, see feed_trace(). Returns
+  // false at the first line that is not an address, or that holds an address above
+  // sim.get_max_id() that is not a key.
+  bool replay(CacheSim& sim, bool keys = false);
+};
+
+// Bytes of a mapped trace consumed between releases of its pages
+constexpr size_t kReleaseBytes = 16 << 20;
+
+// Map the whole file at path read only. Returns nullptr on failure, or for an empty file.
+const void* map_file(const std::string& path, size_t& size);
+
+// Drop the pages of a read only mapping that lie entirely within [begin, end)
+void release_pages(const void* data, size_t begin, size_t end);
+
+// Returns if the file at path is a binary trace
+bool is_binary_trace(const std::string& path);
+
+#endif  // ONLINE_CACHE_SIMULATOR_TRACE_FORMAT_H_
@@ -0,0 +1,140 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "increment_and_freeze.h"
+#include "test_traces.h"
+#include "trace_format.h"
+
+TEST(TraceFormatTests, BinaryTraceFormat) {
+  // several blocks, a partial last block, and deltas of every width
+  std::mt19937_64 gen(11);
+  std::vector<req_count_t> trace = skewed_trace(3 * kTraceBlockAccesses + 1000, 5'000, 42);
+  for (size_t i = 0; i < trace.size(); i += 97)
+    trace[i] = gen() >> (gen() % 64);
+  trace.back() = (req_count_t)-1;
+
+  std::string path = testing::TempDir() + "/iaf_binary" + kTraceExtension;
+  TraceWriter writer(path);
+  for (auto addr : trace)
+    writer.append(addr);
+  ASSERT_TRUE(writer.close());
+  ASSERT_TRUE(is_binary_trace(path));
+  ASSERT_FALSE(is_binary_trace(path + ".missing"));
+
+  TraceReader reader;
+  ASSERT_TRUE(reader.open(path));
+  ASSERT_EQ(reader.get_num_blocks(), 4);
+  ASSERT_EQ(reader.get_num_accesses(), trace.size());
+  ASSERT_EQ(reader.get_max_addr(), trace.back());
+  std::vector<uint64_t> decoded;
+  ASSERT_TRUE(reader.decode_all(decoded));
+  ASSERT_EQ(decoded, std::vector<uint64_t>(trace.begin(), trace.end()));
+
+  IncrementAndFreeze direct, replayed;
+  ASSERT_TRUE(reader.replay(replayed));
+  ASSERT_EQ(replayed.get_success_function(), run_trace(direct, trace));
+
+  // addresses are 64 bits wide whatever the width of req_count_t, and a simulator is never fed
+  // an address wider than its ids
+  const uint64_t wide_addr = (1ull << 40) + 7;
+  std::string wide_path = testing::TempDir() + "/iaf_wide" + kTraceExtension;
+  TraceWriter wide_writer(wide_path);
+  wide_writer.append(3);
+  wide_writer.append(wide_addr);
+  ASSERT_TRUE(wide_writer.close());
+  TraceReader wide_reader;
+  ASSERT_TRUE(wide_reader.open(wide_path));
+  ASSERT_EQ(wide_reader.get_max_addr(), wide_addr);
+  ASSERT_TRUE(wide_reader.decode_all(decoded));
+  ASSERT_EQ(decoded, std::vector<uint64_t>({3, wide_addr}));
+  BasicIncrementAndFreeze<uint64_t, uint64_t, uint64_t> wide;
+  ASSERT_TRUE(wide_reader.replay(wide));
+  ASSERT_EQ(wide.get_success_function()[1], 0);
+  BasicIncrementAndFreeze<uint32_t, uint32_t, uint32_t> narrow;
+  ASSERT_FALSE(wide_reader.replay(narrow));
+}
+
+TEST(TraceFormatTests, CorruptBlock) {
+  std::vector<req_count_t> trace = skewed_trace(2 * kTraceBlockAccesses, 5'000, 45);
+  std::string path = testing::TempDir() + "/iaf_corrupt" + kTraceExtension;
+  TraceWriter writer(path);
+  for (auto addr : trace)
+    writer.append(addr);
+  ASSERT_TRUE(writer.close());
+  uint64_t second_block;
+  {
+    TraceReader reader;
+    ASSERT_TRUE(reader.open(path));
+    second_block = reader.block_entry(1).offset;
+  }
+
+  // a first block of unterminated varints must not be decoded past its end
+  std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+  file.write(std::string(second_block, (char)0xff).data(), second_block);
+  file.close();
+  TraceReader reader;
+  ASSERT_TRUE(reader.open(path));
+  std::vector<uint64_t> addrs(kTraceBlockAccesses);
+  ASSERT_FALSE(reader.decode_block(0, addrs.data()));
+  ASSERT_TRUE(reader.decode_block(1, addrs.data()));
+  std::vector<uint64_t> decoded;
+  ASSERT_FALSE(reader.decode_all(decoded));
+  IncrementAndFreeze replayed;
+  ASSERT_FALSE(reader.replay(replayed));
+}
+
+TEST(TraceFormatTests, TextTraceReader) {
+  std::vector<req_count_t> trace = skewed_trace(100'000, 5'000, 43);
+  std::string path = testing::TempDir() + "/iaf_text_trace";
+  {
+    std::ofstream out(path);
+    for (auto addr : trace)
+      out << addr << (addr % 3 ? "\n" : "\r\n");
+  }
+  IncrementAndFreeze direct, replayed;
+  TextTraceReader reader;
+  ASSERT_TRUE(reader.open(path));
+  ASSERT_TRUE(reader.replay(replayed));
+  ASSERT_EQ(reader.get_num_accesses(), trace.size());
+  ASSERT_EQ(replayed.get_success_function(), run_trace(direct, trace));
+
+  std::ofstream(path) << "1\n2\n3x\n4\n";
+  IncrementAndFreeze malformed;
+  TextTraceReader bad_reader;
+  ASSERT_TRUE(bad_reader.open(path));
+  ASSERT_FALSE(bad_reader.replay(malformed));
+  ASSERT_EQ(bad_reader.get_error_line(), 3);
+
+  // the parser reads 64 bit addresses but rejects those above its bound
+  const std::string wide_text = "1\n1099511627776\n";
+  std::vector<uint64_t> addrs;
+  TextStreamParser wide_parser;
+  ASSERT_TRUE(wide_parser.parse(wide_text.data(), wide_text.size(), addrs));
+  ASSERT_EQ(addrs, std::vector<uint64_t>({1, 1ull << 40}));
+  TextStreamParser bounded_parser(UINT32_MAX);
+  ASSERT_FALSE(bounded_parser.parse(wide_text.data(), wide_text.size(), addrs));
+  ASSERT_EQ(bounded_parser.get_error_line(), 2);
+}
@@ -0,0 +1,129 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "tuning_profile.h"
+
+#include <omp.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+const char* solver_name(BaseCaseSolver solver) {
+  return solver == FENWICK_TREE ? "FENWICK_TREE" : "BRUTE_FORCE";
+}
+
+const char* scheduler_name(Scheduler scheduler) {
+  return scheduler == WORK_STEALING ? "WORK_STEALING" : "OPENMP_TASKS";
+}
+
+// Parse a single key=value field into entry. Returns false if it is not recognized.
+bool parse_field(const std::string& key, const std::string& value, TuningEntry& entry) {
+  IafConfig& config = entry.config;
+  try {
+    if (key == "threads")             entry.threads = std::stoull(value);
+    else if (key == "branching") {
+      config.branching = std::stoull(value);
+      if (!is_iaf_branching(config.branching)) return false;
+    }
+    else if (key == "base_case_size") config.base_case_size = std::stoull(value);
+    else if (key == "task_cutoff")    config.task_cutoff = std::stoull(value);
+    else if (key == "base_case_solver") {
+      if (value == "BRUTE_FORCE")       config.base_case_solver = BRUTE_FORCE;
+      else if (value == "FENWICK_TREE") config.base_case_solver = FENWICK_TREE;
+      else return false;
+    }
+    else if (key == "scheduler") {
+      if (value == "OPENMP_TASKS")       config.scheduler = OPENMP_TASKS;
+      else if (value == "WORK_STEALING") config.scheduler = WORK_STEALING;
+      else return false;
+    }
+    else return false;
+  } catch (const std::exception&) {
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+bool write_tuning_profile(const std::string& path, const std::vector<TuningEntry>& entries) {
+  std::ofstream out(path);
+  if (!out.is_open()) return false;
+  out << "# Increment-and-Freeze tuning profile written by iaf_autotune" << std::endl;
+  for (auto& entry : entries) {
+    const IafConfig& config = entry.config;
+    out << "threads=" << entry.threads
+        << " branching=" << config.branching
+        << " base_case_solver=" << solver_name(config.base_case_solver)
+        << " base_case_size=" << config.base_case_size
+        << " scheduler=" << scheduler_name(config.scheduler)
+        << " task_cutoff=" << config.task_cutoff << std::endl;
+  }
+  return out.good();
+}
+
+bool read_tuning_profile(const std::string& path, std::vector<TuningEntry>& entries) {
+  entries.clear();
+  std::ifstream in(path);
+  if (!in.is_open()) return false;
+
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    std::istringstream fields(line);
+    std::string field;
+    TuningEntry entry{1, IafConfig()};
+    while (fields >> field) {
+      size_t eq = field.find('=');
+      if (eq == std::string::npos || !parse_field(field.substr(0, eq), field.substr(eq + 1), entry)) {
+        std::cerr << "ERROR: Malformed field '" << field << "' in tuning profile " << path << std::endl;
+        entries.clear();
+        return false;
+      }
+    }
+    entries.push_back(entry);
+  }
+  return true;
+}
+
+IafConfig select_tuning(const std::vector<TuningEntry>& entries, size_t num_threads) {
+  const TuningEntry* best = nullptr;
+  for (auto& entry : entries) {
+    if (best == nullptr)
+      best = &entry;
+    else if (entry.threads <= num_threads)
+      best = (best->threads > num_threads || entry.threads > best->threads) ? &entry : best;
+    else if (best->threads > num_threads && entry.threads < best->threads)
+      best = &entry;
+  }
+  return best == nullptr ? IafConfig() : best->config;
+}
+
+IafConfig tuned_config() {
+  static const std::vector<TuningEntry> entries = []() {
+    std::vector<TuningEntry> entries;
+    const char* path = std::getenv(kTuningProfileEnv);
+    if (path != nullptr && !read_tuning_profile(path, entries))
+      std::cerr << "WARNING: Could not load tuning profile " << path << ", using defaults" << std::endl;
+    return entries;
+  }();
+  return select_tuning(entries, omp_get_max_threads());
+}
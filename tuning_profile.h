@@ -0,0 +1,62 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef ONLINE_CACHE_SIMULATOR_TUNING_PROFILE_H_
+#define ONLINE_CACHE_SIMULATOR_TUNING_PROFILE_H_
+
+#include <cstddef>      // for size_t
+#include <string>       // for string
+#include <vector>       // for vector
+
+#include "iaf_params.h" // for IafConfig
+
+// Environment variable that names the tuning profile loaded by tuned_config()
+constexpr char kTuningProfileEnv[] = "IAF_TUNING_PROFILE";
+
+// The best IafConfig found by iaf_autotune when running with a number of threads
+struct TuningEntry {
+  size_t threads;
+  IafConfig config;
+};
+
+/*
+ * A tuning profile is a text file with one TuningEntry per line of the form
+ *   threads=4 branching=16 base_case_solver=FENWICK_TREE base_case_size=4096 ...
+ * Fields that are not present keep their IafConfig default. Lines beginning with # are ignored.
+ */
+
+// Write entries to path. Returns false if the file could not be written.
+bool write_tuning_profile(const std::string& path, const std::vector<TuningEntry>& entries);
+
+// Read the entries of the profile at path. Returns false if the file could not be read
+// or is malformed, in which case entries is left empty.
+bool read_tuning_profile(const std::string& path, std::vector<TuningEntry>& entries);
+
+// The config of the entry with the most threads not exceeding num_threads. If every entry
+// has more threads then the entry with the fewest is used. IafConfig() if there are none.
+IafConfig select_tuning(const std::vector<TuningEntry>& entries, size_t num_threads);
+
+/*
+ * IafConfig() overridden by the profile named by $IAF_TUNING_PROFILE for
+ * omp_get_max_threads() threads. The profile is read once. If the variable is
+ * not set or the profile cannot be read then IafConfig() is returned.
+ */
+IafConfig tuned_config();
+
+#endif  // ONLINE_CACHE_SIMULATOR_TUNING_PROFILE_H_
@@ -17,8 +17,15 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "sim_factory.h"
+#include "partition.h"
+#include "test_traces.h"
 
 class CacheSimUnitTests : public testing::TestWithParam<CacheSimType> {};
 INSTANTIATE_TEST_SUITE_P(CacheSimSuite, CacheSimUnitTests,
@@ -131,3 +138,104 @@ TEST_P(CacheSimUnitTests, MultipleSuccessCalls) {
     }
   }
 }
+
+// Simulators given the bounds of a trace choose narrow or wide ids, which must agree
+TEST_P(CacheSimUnitTests, WidthsFromBounds) {
+  TraceBounds narrow{6, 240};
+  TraceBounds wide{UINT64_MAX, 240};
+  std::unique_ptr<CacheSim> narrow_sim = new_simulator(GetParam(), 8, 0, tuned_config(), &narrow);
+  std::unique_ptr<CacheSim> wide_sim = new_simulator(GetParam(), 8, 0, tuned_config(), &wide);
+
+  // the wide simulator gets the same trace upon ids too large for 32 bits
+  const uint64_t wide_base = (uint64_t)1 << 40;
+  for (size_t i = 0; i < 20; i++) {
+    for (uint64_t addr : {1, 2, 3, 4, 1, 2, 3, 4, 5, 4, 6, 5}) {
+      narrow_sim->memory_access(addr);
+      wide_sim->memory_access(wide_base + addr);
+    }
+  }
+  SuccessVector svec = narrow_sim->get_success_function();
+  ASSERT_GE(svec.size(), 7);
+  EXPECT_EQ(svec[6], 12 * 20 - 6);
+  EXPECT_EQ(wide_sim->get_success_function(), svec);
+}
+
+TEST(IafUnitTests, ExtentAccess) {
+  std::mt19937_64 gen(46);
+  std::vector<std::pair<req_count_t, size_t>> extents;
+  std::vector<req_count_t> expanded;
+  for (size_t i = 0; i < 20'000; i++) {
+    req_count_t first = gen() % 50'000;
+    size_t num_blocks = gen() % 4 == 0 ? gen() % 70 : 1 + gen() % 8;
+    extents.emplace_back(first, num_blocks);
+    for (size_t b = 0; b < num_blocks; b++)
+      expanded.push_back(first + b);
+  }
+
+  IncrementAndFreeze direct;
+  CacheSim::SuccessVector expected = run_trace(direct, expanded);
+  IncrementAndFreeze iaf;
+  BoundedIAF bounded(1000); // extents span chunks
+  for (auto [first, num_blocks] : extents) {
+    iaf.extent_access(first, num_blocks);
+    bounded.extent_access(first, num_blocks);
+  }
+  ASSERT_EQ(iaf.get_success_function(), expected);
+  CacheSim::SuccessVector bounded_success = bounded.get_success_function();
+  bounded_success.resize(expected.size(), bounded_success.back());
+  ASSERT_EQ(bounded_success, expected);
+
+  // bytes [4095, 8193) overlap blocks 0, 1 and 2 of 4 KiB
+  ContainerCacheSim blocks;
+  blocks.byte_extent_access(4095, 4098, 4096, 10);
+  blocks.byte_extent_access(0, 1, 4096, 10);
+  blocks.byte_extent_access(0, 0, 4096, 10);
+  ASSERT_EQ(blocks.get_success_function()[3], 1);
+}
+
+TEST(IafUnitTests, IdWidth) {
+  // ids too wide for a simulator end the process rather than merge with narrower ids
+  testing::GTEST_FLAG(death_test_style) = "threadsafe";
+  BasicIncrementAndFreeze<uint32_t, uint32_t, uint32_t> narrow;
+  narrow.memory_access(UINT32_MAX);
+  ASSERT_DEATH(narrow.memory_access((uint64_t)1 << 40), "does not fit the 32 bit ids");
+  ASSERT_DEATH(narrow.extent_access(UINT32_MAX, 2), "does not fit the 32 bit ids");
+  BasicBoundedIAF<uint32_t, uint32_t, uint64_t> bounded;
+  ASSERT_DEATH(bounded.memory_access((uint64_t)1 << 32), "does not fit the 32 bit ids");
+  BasicIncrementAndFreeze<uint64_t, uint64_t, uint64_t> wide;
+  ASSERT_DEATH(wide.extent_access(UINT64_MAX, 2), "does not fit the 64 bit ids");
+}
+
+TEST(IafUnitTests, Segments) {
+  // traces longer than a segment carry their living requests from segment to segment
+  IafConfig config;
+  config.segment_size = 5'000;
+  std::vector<req_count_t> trace = skewed_trace(50'000, 2'000, 49);
+  IncrementAndFreeze segmented(config), whole;
+  CacheSim::SuccessVector expected = run_trace(whole, trace);
+  ASSERT_EQ(run_trace(segmented, trace), expected);
+
+  // segments too small for the distinct ids grow rather than fail
+  IafConfig tiny_config;
+  tiny_config.segment_size = 100;
+  IncrementAndFreeze tiny(tiny_config);
+  ASSERT_EQ(run_trace(tiny, trace), expected);
+
+  // extents span segments and the success function may be taken between them
+  std::vector<req_count_t> expanded;
+  IncrementAndFreeze segmented_extents(config);
+  for (size_t i = 0; i < 2'000; i++) {
+    req_count_t first = (i * 37) % 1'500;
+    segmented_extents.extent_access(first, 7);
+    for (size_t b = 0; b < 7; b++)
+      expanded.push_back(first + b);
+    if (i == 1'000) segmented_extents.get_success_function();
+  }
+  IncrementAndFreeze direct;
+  ASSERT_EQ(segmented_extents.get_success_function(), run_trace(direct, expanded));
+
+  // partitions index every op of the largest segment, which has up to two per request
+  using State = PartitionState<kIafBranching, CompactOp>;
+  static_assert(std::numeric_limits<decltype(State::cur_idx)>::max()
+                >= 2 * CompactOp::max_requests);
+}
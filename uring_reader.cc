@@ -0,0 +1,239 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "uring_reader.h"
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+[[noreturn]] static void io_error(const std::string& what, int err) {
+  std::cerr << "ERROR: Uring reader could not " << what << ": " << strerror(err) << std::endl;
+  exit(EXIT_FAILURE);
+}
+
+UringReader::UringReader(size_t queue_depth, size_t block_bytes)
+    : queue_depth(std::max(queue_depth, (size_t) 1)),
+      block_bytes((std::max(block_bytes, (size_t) 1) + kUringAlignment - 1) / kUringAlignment
+                  * kUringAlignment) {}
+
+UringReader::~UringReader() {
+  if (ring_fd >= 0) ::close(ring_fd);
+  if (sqes != nullptr) munmap(sqes, sqes_bytes);
+  if (cq_ring != nullptr && cq_ring != sq_ring) munmap(cq_ring, cq_ring_bytes);
+  if (sq_ring != nullptr) munmap(sq_ring, sq_ring_bytes);
+  if (fd >= 0) ::close(fd);
+  free(buffers);
+}
+
+bool UringReader::setup_ring() {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd = syscall(__NR_io_uring_setup, queue_depth, &params);
+  if (ring_fd < 0) return false;
+
+  sq_ring_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_bytes = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+    sq_ring_bytes = cq_ring_bytes = std::max(sq_ring_bytes, cq_ring_bytes);
+  sq_ring = mmap(nullptr, sq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                 ring_fd, IORING_OFF_SQ_RING);
+  if (sq_ring == MAP_FAILED) {
+    sq_ring = nullptr;
+    return false;
+  }
+  if (params.features & IORING_FEAT_SINGLE_MMAP) cq_ring = sq_ring;
+  else {
+    cq_ring = mmap(nullptr, cq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ring_fd, IORING_OFF_CQ_RING);
+    if (cq_ring == MAP_FAILED) {
+      cq_ring = nullptr;
+      return false;
+    }
+  }
+  sqes_bytes = params.sq_entries * sizeof(struct io_uring_sqe);
+  void* sqe_map = mmap(nullptr, sqes_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ring_fd, IORING_OFF_SQES);
+  if (sqe_map == MAP_FAILED) return false;
+  sqes = (struct io_uring_sqe*) sqe_map;
+
+  char* sq = (char*) sq_ring;
+  char* cq = (char*) cq_ring;
+  sq_tail = (unsigned*) (sq + params.sq_off.tail);
+  sq_mask = (unsigned*) (sq + params.sq_off.ring_mask);
+  sq_array = (unsigned*) (sq + params.sq_off.array);
+  cq_head = (unsigned*) (cq + params.cq_off.head);
+  cq_tail = (unsigned*) (cq + params.cq_off.tail);
+  cq_mask = (unsigned*) (cq + params.cq_off.ring_mask);
+  cqes = (struct io_uring_cqe*) (cq + params.cq_off.cqes);
+
+  // registered buffers save pinning the pages of every read, but are only an optimization
+  std::vector<struct iovec> iovecs(queue_depth);
+  for (size_t i = 0; i < queue_depth; i++)
+    iovecs[i] = {buffers + i * block_bytes, block_bytes};
+  fixed_buffers = syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_BUFFERS,
+                          iovecs.data(), queue_depth) == 0;
+  return true;
+}
+
+bool UringReader::open(const std::string& path, uint64_t len) {
+  fd = ::open(path.c_str(), O_RDONLY | O_DIRECT);
+  stats.direct = fd >= 0;
+  if (fd < 0) fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) return false;
+  length = std::min(len, (uint64_t) file_stat.st_size);
+
+  buffers = (uint8_t*) aligned_alloc(kUringAlignment, queue_depth * block_bytes);
+  if (buffers == nullptr || !setup_ring()) return false;
+
+  slots.resize(queue_depth);
+  for (size_t i = 0; i < queue_depth; i++)
+    fill_slot(i);
+  submit();
+  return true;
+}
+
+void UringReader::submit_read(size_t slot, uint64_t offset, size_t len) {
+  // this thread is the only producer so the tail is only published, not contended
+  unsigned tail = *sq_tail;
+  unsigned idx = tail & *sq_mask;
+  struct io_uring_sqe* sqe = &sqes[idx];
+  memset(sqe, 0, sizeof(*sqe));
+  uint8_t* buffer = buffers + slot * block_bytes + (offset - slots[slot].offset);
+  sqe->opcode = fixed_buffers ? IORING_OP_READ_FIXED : IORING_OP_READ;
+  sqe->fd = fd;
+  sqe->addr = (uint64_t) buffer;
+  sqe->len = len;
+  sqe->off = offset;
+  sqe->buf_index = fixed_buffers ? slot : 0;
+  sqe->user_data = slot;
+  sq_array[idx] = idx;
+  __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+  ++to_submit;
+  ++stats.reads;
+}
+
+// Submit the read of the next block of the file into slot, if any remain
+void UringReader::fill_slot(size_t slot) {
+  if (next_offset >= length) {
+    slots[slot] = {next_offset, 0, 0, true};
+    return;
+  }
+  // reads past the end of the file are short, so read whole aligned blocks
+  slots[slot] = {next_offset, 0, (size_t) std::min((uint64_t) block_bytes, length - next_offset),
+                 false};
+  submit_read(slot, next_offset, block_bytes);
+  next_offset += block_bytes;
+}
+
+// Submit the queued reads without waiting for any
+void UringReader::submit() {
+  while (to_submit > 0) {
+    long ret = syscall(__NR_io_uring_enter, ring_fd, to_submit, 0, 0, nullptr, 0);
+    if (ret >= 0) to_submit -= std::min((unsigned long) ret, (unsigned long) to_submit);
+    else if (errno != EINTR) io_error("submit reads", errno);
+  }
+}
+
+// Submit the queued reads and reap at least one completion
+void UringReader::wait_completions() {
+  auto start = std::chrono::steady_clock::now();
+  while (true) {
+    long ret = syscall(__NR_io_uring_enter, ring_fd, to_submit, 1, IORING_ENTER_GETEVENTS,
+                       nullptr, 0);
+    if (ret >= 0) {
+      to_submit -= std::min((unsigned long) ret, (unsigned long) to_submit);
+      break;
+    }
+    if (errno != EINTR) io_error("wait for reads", errno);
+  }
+  stats.stall_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+                         .count();
+
+  unsigned head = *cq_head;
+  while (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+    struct io_uring_cqe* cqe = &cqes[head & *cq_mask];
+    Slot& slot = slots[cqe->user_data];
+    if (cqe->res < 0) io_error("read", -cqe->res);
+    slot.filled += cqe->res;
+    stats.bytes_read += cqe->res;
+    if (slot.filled >= slot.expected) slot.done = true;
+    else if (cqe->res == 0) io_error("read", EIO); // the file shrank
+    else submit_read(cqe->user_data, slot.offset + slot.filled, block_bytes - slot.filled);
+    ++head;
+  }
+  __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+}
+
+bool UringReader::next(const uint8_t*& data, size_t& len) {
+  if (next_block > 0) {
+    fill_slot((next_block - 1) % queue_depth);
+    submit();
+  }
+  size_t slot = next_block % queue_depth;
+  if (slots[slot].expected == 0) return false;
+  while (!slots[slot].done)
+    wait_completions();
+  data = buffers + slot * block_bytes;
+  len = slots[slot].expected;
+  ++next_block;
+  return true;
+}
+
+bool UringTraceReader::open(const std::string& path) {
+  binary = index.open(path);
+  return reader.open(path, binary ? index.get_data_bytes() : UINT64_MAX);
+}
+
+bool UringTraceReader::replay(CacheSim& sim, bool keys) {
+  if (!keys && binary && index.get_max_addr() > sim.get_max_id()) return false;
+  TraceStreamDecoder decoder(index);
+  TextStreamParser parser(keys ? UINT64_MAX : sim.get_max_id());
+  std::vector<uint64_t> addrs;
+  const uint8_t* data;
+  size_t len;
+  bool ok = true;
+  while (ok && reader.next(data, len)) {
+    ok = binary ? decoder.decode(data, len, addrs) : parser.parse((const char*) data, len, addrs);
+    feed_trace(sim, addrs.data(), addrs.size(), keys);
+    num_accesses += addrs.size();
+    addrs.clear();
+  }
+  if (binary) return ok && decoder.done();
+
+  ok = ok && parser.finish(addrs);
+  feed_trace(sim, addrs.data(), addrs.size(), keys);
+  num_accesses += addrs.size();
+  error_line = parser.get_error_line();
+  return ok;
+}
@@ -0,0 +1,139 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef ONLINE_CACHE_SIMULATOR_URING_READER_H_
+#define ONLINE_CACHE_SIMULATOR_URING_READER_H_
+
+#include <cstddef>        // for size_t
+#include <cstdint>        // for uint64_t, uint8_t
+#include <string>         // for string
+#include <vector>         // for vector
+
+#include "cache_sim.h"    // for CacheSim
+#include "trace_format.h" // for TraceReader, TextStreamParser
+
+// Reads in flight at once and the bytes of each, see UringReader
+constexpr size_t kUringQueueDepth = 8;
+constexpr size_t kUringBlockBytes = 1 << 20;
+
+// O_DIRECT requires the buffer, offset and length of every read to be aligned to this
+constexpr size_t kUringAlignment = 4096;
+
+struct UringStats {
+  uint64_t bytes_read = 0;
+  uint64_t reads = 0;
+  double stall_seconds = 0; // spent waiting for reads to complete
+  bool direct = false;      // if the file was read with O_DIRECT
+};
+
+/*
+ * Reads a file from start to end through an io_uring. Up to queue_depth reads of block_bytes
+ * into a ring of aligned buffers are kept in flight, so the caller computes upon one block
+ * while the following blocks are read. The file is opened with O_DIRECT, bypassing the page
+ * cache, where the file system allows it.
+ */
+class UringReader {
+ private:
+  struct Slot {
+    uint64_t offset;   // in the file of the block
+    size_t filled;     // bytes read so far
+    size_t expected;   // bytes of the file in the block
+    bool done;
+  };
+
+  const size_t queue_depth;
+  const size_t block_bytes;
+  int fd = -1;
+  int ring_fd = -1;
+  uint64_t length = 0;       // bytes to read
+  uint8_t* buffers = nullptr;
+  std::vector<Slot> slots;
+  bool fixed_buffers = false;
+  uint64_t next_offset = 0;  // of the next block to submit
+  uint64_t next_block = 0;   // next block to return
+  unsigned to_submit = 0;
+  UringStats stats;
+
+  // the mapped rings
+  void* sq_ring = nullptr;
+  void* cq_ring = nullptr;
+  size_t sq_ring_bytes = 0;
+  size_t cq_ring_bytes = 0;
+  struct io_uring_sqe* sqes = nullptr;
+  size_t sqes_bytes = 0;
+  unsigned* sq_tail;
+  unsigned* sq_mask;
+  unsigned* sq_array;
+  unsigned* cq_head;
+  unsigned* cq_tail;
+  unsigned* cq_mask;
+  struct io_uring_cqe* cqes;
+
+  bool setup_ring();
+  void submit_read(size_t slot, uint64_t offset, size_t len);
+  void fill_slot(size_t slot);
+  void submit();
+  void wait_completions();
+ public:
+  UringReader(size_t queue_depth = kUringQueueDepth, size_t block_bytes = kUringBlockBytes);
+  ~UringReader();
+  UringReader(const UringReader&) = delete;
+  UringReader& operator=(const UringReader&) = delete;
+
+  // Begin reading the first len bytes of the file at path, or all of it if len is larger.
+  // Returns false if the file cannot be opened or io_uring is not available.
+  bool open(const std::string& path, uint64_t len = UINT64_MAX);
+
+  // Return the next block of the file in data and len. It is valid until the next call, which
+  // resubmits its buffer. Returns false once the whole file has been returned.
+  bool next(const uint8_t*& data, size_t& len);
+
+  const UringStats& get_stats() const { return stats; }
+};
+
+// Reads a text or binary trace through a UringReader and feeds it to a CacheSim
+class UringTraceReader {
+ private:
+  UringReader reader;
+  TraceReader index;  // of a binary trace
+  bool binary = false;
+  uint64_t num_accesses = 0;
+  uint64_t error_line = 0;
+ public:
+  UringTraceReader(size_t queue_depth = kUringQueueDepth, size_t block_bytes = kUringBlockBytes)
+   : reader(queue_depth, block_bytes) {};
+
+  // Returns false if the trace cannot be opened or io_uring is not available
+  bool open(const std::string& path);
+
+  // Feed every address to sim in order, a block at a time, as keys if keys is set, see
+  // feed_trace(). Returns false if the trace is malformed or holds an address above
+  // sim.get_max_id() that is not a key.
+  bool replay(CacheSim& sim, bool keys = false);
+
+  uint64_t get_num_accesses() const { return num_accesses; }
+
+  // Line of the first malformed address of a text trace, or 0 if there is none
+  uint64_t get_error_line() const { return error_line; }
+
+  const UringStats& get_stats() const { return reader.get_stats(); }
+};
+
+#endif  // ONLINE_CACHE_SIMULATOR_URING_READER_H_
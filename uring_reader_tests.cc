@@ -0,0 +1,74 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "increment_and_freeze.h"
+#include "test_traces.h"
+#include "trace_format.h"
+#include "uring_reader.h"
+
+TEST(UringReaderTests, UringTraceReader) {
+  std::vector<req_count_t> trace = skewed_trace(2 * kTraceBlockAccesses + 7, 5'000, 44);
+  std::string binary_path = testing::TempDir() + "/iaf_uring" + kTraceExtension;
+  std::string text_path = testing::TempDir() + "/iaf_uring_text";
+  TraceWriter writer(binary_path);
+  std::ofstream text(text_path);
+  for (auto addr : trace) {
+    writer.append(addr);
+    text << addr << "\n";
+  }
+  ASSERT_TRUE(writer.close());
+  text.close();
+
+  IncrementAndFreeze direct;
+  CacheSim::SuccessVector expected = run_trace(direct, trace);
+  for (auto& path : {binary_path, text_path}) {
+    // small reads split addresses and blocks between reads
+    UringTraceReader reader(3, kUringAlignment);
+    if (!reader.open(path)) GTEST_SKIP() << "io_uring is not available";
+    IncrementAndFreeze replayed;
+    ASSERT_TRUE(reader.replay(replayed));
+    ASSERT_EQ(reader.get_num_accesses(), trace.size());
+    ASSERT_EQ(replayed.get_success_function(), expected);
+  }
+}
+
+TEST(UringReaderTests, OverlongVarint) {
+  std::vector<req_count_t> trace = skewed_trace(1000, 100, 50);
+  std::string path = testing::TempDir() + "/iaf_uring_overlong" + kTraceExtension;
+  TraceWriter writer(path);
+  for (auto addr : trace)
+    writer.append(addr);
+  ASSERT_TRUE(writer.close());
+
+  // a varint of more than kMaxVarintBytes bytes is rejected before it overflows
+  std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+  file.write(std::string(2 * kMaxVarintBytes, (char)0xff).data(), 2 * kMaxVarintBytes);
+  file.close();
+  UringTraceReader reader(3, kUringAlignment);
+  if (!reader.open(path)) GTEST_SKIP() << "io_uring is not available";
+  IncrementAndFreeze replayed;
+  ASSERT_FALSE(reader.replay(replayed));
+  ASSERT_EQ(reader.get_num_accesses(), 0);
+}
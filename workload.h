@@ -0,0 +1,73 @@
+/*
+ * Increment-and-Freeze is an efficient library for computing LRU hit-rate curves.
+ * Copyright (C) 2023 Daniel DeLayo, Bradley Kuszmaul, Evan West
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef ONLINE_CACHE_SIMULATOR_WORKLOAD_H_
+#define ONLINE_CACHE_SIMULATOR_WORKLOAD_H_
+
+#include <algorithm>  // for shuffle
+#include <cmath>      // for pow, round
+#include <cstdint>    // for uint64_t
+#include <random>     // for mt19937_64
+#include <vector>     // for vector
+
+#include "params.h"   // for kAccesses, kIdUniverseSize
+
+// Generate num_accesses accesses upon universe ids in which id i appears in proportion to
+// 1 / (i+1)^alpha, shuffled. An alpha of 0 gives every id the same number of accesses.
+inline std::vector<uint64_t> generate_zipf(uint64_t seed, double alpha,
+                                           uint64_t num_accesses = kAccesses,
+                                           uint64_t universe = kIdUniverseSize) {
+  std::mt19937_64 rand(seed); // create random number generator
+  std::vector<double> freq_vec;
+  freq_vec.reserve(universe);
+  // generate the divisor
+  double divisor = 0;
+  for (uint64_t i = 1; i < universe + 1; i++) {
+    divisor += 1 / pow(i, alpha);
+  }
+
+  // now for each id calculate it's normalized frequency
+  for (uint64_t i = 1; i < universe + 1; i++)
+    freq_vec.push_back((1 / pow(i, alpha)) / divisor);
+
+  // now push to sequence vector based upon frequency
+  std::vector<uint64_t> seq_vec;
+  seq_vec.reserve(num_accesses);
+  for (uint64_t i = 0; i < universe; i++) {
+    uint64_t num_items = round(freq_vec[i] * num_accesses);
+    for (uint64_t j = 0; j < num_items && seq_vec.size() < num_accesses; j++)
+      seq_vec.push_back(i);
+  }
+
+  // if we have too few accesses make up for it by adding more to most common
+  if (seq_vec.size() < num_accesses) {
+    uint64_t num_needed = num_accesses - seq_vec.size();
+    for (uint64_t i = 0; i < num_needed; i++)
+      seq_vec.push_back(i % universe);
+  }
+
+  seq_vec.resize(num_accesses);
+
+  // shuffle the sequence vector
+  std::shuffle(seq_vec.begin(), seq_vec.end(), rand);
+  return seq_vec;
+}
+
+#endif  // ONLINE_CACHE_SIMULATOR_WORKLOAD_H_